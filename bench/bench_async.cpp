@@ -0,0 +1,45 @@
+#include <benchmark/benchmark.h>
+
+#include <tconcurrent/async.hpp>
+#include <tconcurrent/thread_pool.hpp>
+
+using namespace tconcurrent;
+
+namespace
+{
+void async_round_trip(benchmark::State& state, executor e)
+{
+  for (auto _ : state)
+    async(e, [] {}).get();
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_async_round_trip_default(benchmark::State& state)
+{
+  async_round_trip(state, get_default_executor());
+}
+BENCHMARK(BM_async_round_trip_default)->UseRealTime();
+
+void BM_async_round_trip_background(benchmark::State& state)
+{
+  async_round_trip(state, get_background_executor());
+}
+BENCHMARK(BM_async_round_trip_background)->UseRealTime();
+
+// post range(0) tasks from the caller and wait for the last one
+void BM_async_burst(benchmark::State& state)
+{
+  thread_pool tp;
+  tp.start(1);
+  auto const nb_tasks = state.range(0);
+  for (auto _ : state)
+  {
+    for (int64_t i = 1; i < nb_tasks; ++i)
+      async(tp, [] {});
+    async(tp, [] {}).get();
+  }
+  state.SetItemsProcessed(state.iterations() * nb_tasks);
+  tp.stop();
+}
+BENCHMARK(BM_async_burst)->RangeMultiplier(8)->Range(8, 4096)->UseRealTime();
+}
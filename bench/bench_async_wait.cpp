@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+
+#include <tconcurrent/async.hpp>
+#include <tconcurrent/async_wait.hpp>
+#include <tconcurrent/promise.hpp>
+#include <tconcurrent/when.hpp>
+#include <tconcurrent/with_timeout.hpp>
+
+#include <chrono>
+#include <vector>
+
+using namespace std::chrono_literals;
+using namespace tconcurrent;
+
+namespace
+{
+// arm range(0) timers and cancel them before they fire, like timeouts that
+// are not reached
+void BM_async_wait_cancel(benchmark::State& state)
+{
+  auto const nb_timers = state.range(0);
+  std::vector<future<void>> timers;
+  timers.reserve(nb_timers);
+  for (auto _ : state)
+  {
+    for (int64_t i = 0; i < nb_timers; ++i)
+      timers.push_back(async_wait(1h));
+    for (auto& timer : timers)
+      timer.request_cancel();
+    timers.clear();
+  }
+  // run the handlers of the canceled timers
+  async([] {}).get();
+  state.SetItemsProcessed(state.iterations() * nb_timers);
+}
+BENCHMARK(BM_async_wait_cancel)->RangeMultiplier(8)->Range(1, 4096);
+
+// arm and cancel one timer while range(0) other timers are armed, like a
+// connection timeout on a busy server
+void BM_async_wait_cancel_among_armed(benchmark::State& state)
+{
+  std::vector<future<void>> armed;
+  armed.reserve(state.range(0));
+  for (int64_t i = 0; i < state.range(0); ++i)
+    armed.push_back(async_wait(1h + i * 1ms));
+  for (auto _ : state)
+  {
+    auto timer = async_wait(30min);
+    timer.request_cancel();
+  }
+  for (auto& timer : armed)
+    timer.request_cancel();
+  async([] {}).get();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_async_wait_cancel_among_armed)->Arg(0)->Arg(1000)->Arg(100000);
+
+// put a timeout on a future that finishes before it, by hand and with
+// with_timeout
+void BM_timeout_when_any(benchmark::State& state)
+{
+  for (auto _ : state)
+  {
+    promise<int> prom;
+    std::vector<future<void>> futures;
+    futures.push_back(prom.get_future().to_void());
+    futures.push_back(async_wait(1h));
+    auto any = when_any(std::make_move_iterator(futures.begin()),
+                        std::make_move_iterator(futures.end()),
+                        when_any_options::auto_cancel);
+    prom.set_value(42);
+    benchmark::DoNotOptimize(any.get());
+  }
+  async([] {}).get();
+}
+BENCHMARK(BM_timeout_when_any);
+
+void BM_with_timeout(benchmark::State& state)
+{
+  for (auto _ : state)
+  {
+    promise<int> prom;
+    auto fut = with_timeout(prom.get_future(), 1h);
+    prom.set_value(42);
+    benchmark::DoNotOptimize(fut.get());
+  }
+}
+BENCHMARK(BM_with_timeout);
+
+// arm range(0) timers that expire immediately and wait for all of them
+void BM_async_wait_expire(benchmark::State& state)
+{
+  auto const nb_timers = state.range(0);
+  std::vector<future<void>> timers;
+  timers.reserve(nb_timers);
+  for (auto _ : state)
+  {
+    for (int64_t i = 0; i < nb_timers; ++i)
+      timers.push_back(async_wait(0s));
+    when_all(std::make_move_iterator(timers.begin()),
+             std::make_move_iterator(timers.end()))
+        .get();
+    timers.clear();
+  }
+  state.SetItemsProcessed(state.iterations() * nb_timers);
+}
+BENCHMARK(BM_async_wait_expire)
+    ->RangeMultiplier(8)
+    ->Range(1, 4096)
+    ->UseRealTime();
+}
@@ -0,0 +1,54 @@
+#include <benchmark/benchmark.h>
+
+#include <tconcurrent/coroutine.hpp>
+#include <tconcurrent/promise.hpp>
+
+using namespace tconcurrent;
+
+// Built once with stackful coroutines in bench_tconcurrent, and once more with
+// stackless coroutines in bench_coroutinests when TCONCURRENT_COROUTINES_TS is
+// enabled.
+
+namespace
+{
+void BM_coroutine_start(benchmark::State& state)
+{
+  for (auto _ : state)
+    async_resumable([]() -> cotask<void> { TC_RETURN(); }).get();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_coroutine_start)->UseRealTime();
+
+// range(0) suspensions that resume through the executor
+void BM_coroutine_yield(benchmark::State& state)
+{
+  auto const nb_yields = state.range(0);
+  for (auto _ : state)
+  {
+    async_resumable([nb_yields]() -> cotask<void> {
+      for (int64_t i = 0; i < nb_yields; ++i)
+        TC_YIELD();
+    }).get();
+  }
+  state.SetItemsProcessed(state.iterations() * nb_yields);
+}
+BENCHMARK(BM_coroutine_yield)->RangeMultiplier(8)->Range(1, 512)->UseRealTime();
+
+// range(0) awaits of futures that are already ready, which do not suspend
+void BM_coroutine_await_ready(benchmark::State& state)
+{
+  auto const nb_awaits = state.range(0);
+  for (auto _ : state)
+  {
+    async_resumable([nb_awaits]() -> cotask<void> {
+      for (int64_t i = 0; i < nb_awaits; ++i)
+        benchmark::DoNotOptimize(TC_AWAIT(make_ready_future(42)));
+    }).get();
+  }
+  state.SetItemsProcessed(state.iterations() * nb_awaits);
+}
+BENCHMARK(BM_coroutine_await_ready)
+    ->RangeMultiplier(8)
+    ->Range(1, 512)
+    ->UseRealTime();
+}
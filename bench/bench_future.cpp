@@ -0,0 +1,140 @@
+#include <benchmark/benchmark.h>
+
+#include <tconcurrent/future.hpp>
+#include <tconcurrent/promise.hpp>
+#include <tconcurrent/when.hpp>
+
+#include <vector>
+
+using namespace tconcurrent;
+
+namespace
+{
+// chain range(0) continuations on a pending future, then complete it
+void BM_then_chain(benchmark::State& state)
+{
+  auto const depth = state.range(0);
+  for (auto _ : state)
+  {
+    promise<int> prom;
+    auto f = prom.get_future();
+    for (int64_t i = 0; i < depth; ++i)
+      f = f.then(get_synchronous_executor(),
+                 [](future<int> f) { return f.get() + 1; });
+    prom.set_value(0);
+    benchmark::DoNotOptimize(f.get());
+  }
+  state.SetItemsProcessed(state.iterations() * depth);
+}
+BENCHMARK(BM_then_chain)->RangeMultiplier(4)->Range(1, 256);
+
+void BM_and_then_chain(benchmark::State& state)
+{
+  auto const depth = state.range(0);
+  for (auto _ : state)
+  {
+    promise<int> prom;
+    auto f = prom.get_future();
+    for (int64_t i = 0; i < depth; ++i)
+      f = f.and_then(get_synchronous_executor(), [](int v) { return v + 1; });
+    prom.set_value(0);
+    benchmark::DoNotOptimize(f.get());
+  }
+  state.SetItemsProcessed(state.iterations() * depth);
+}
+BENCHMARK(BM_and_then_chain)->RangeMultiplier(4)->Range(1, 256);
+
+// wait on range(0) pending futures and complete all of them
+void BM_when_all(benchmark::State& state)
+{
+  auto const nb_futures = state.range(0);
+  for (auto _ : state)
+  {
+    std::vector<promise<void>> promises(nb_futures);
+    std::vector<future<void>> futures;
+    futures.reserve(nb_futures);
+    for (auto const& prom : promises)
+      futures.push_back(prom.get_future());
+    auto all = when_all(std::make_move_iterator(futures.begin()),
+                        std::make_move_iterator(futures.end()));
+    for (auto& prom : promises)
+      prom.set_value({});
+    benchmark::DoNotOptimize(all.get());
+  }
+  state.SetItemsProcessed(state.iterations() * nb_futures);
+}
+BENCHMARK(BM_when_all)->Arg(3)->RangeMultiplier(8)->Range(1, 4096);
+
+// wait on the values of range(0) pending futures and complete all of them
+void BM_when_all_values(benchmark::State& state)
+{
+  auto const nb_futures = state.range(0);
+  for (auto _ : state)
+  {
+    std::vector<promise<int>> promises(nb_futures);
+    std::vector<future<int>> futures;
+    futures.reserve(nb_futures);
+    for (auto const& prom : promises)
+      futures.push_back(prom.get_future());
+    auto all = when_all_values(std::make_move_iterator(futures.begin()),
+                               std::make_move_iterator(futures.end()));
+    for (auto& prom : promises)
+      prom.set_value(0);
+    benchmark::DoNotOptimize(all.get());
+  }
+  state.SetItemsProcessed(state.iterations() * nb_futures);
+}
+BENCHMARK(BM_when_all_values)->RangeMultiplier(8)->Range(1, 4096);
+
+// wait on range(0) pending futures and complete one of them
+void BM_when_any(benchmark::State& state)
+{
+  auto const nb_futures = state.range(0);
+  for (auto _ : state)
+  {
+    std::vector<promise<void>> promises(nb_futures);
+    std::vector<future<void>> futures;
+    futures.reserve(nb_futures);
+    for (auto const& prom : promises)
+      futures.push_back(prom.get_future());
+    auto any = when_any(std::make_move_iterator(futures.begin()),
+                        std::make_move_iterator(futures.end()));
+    promises[nb_futures / 2].set_value({});
+    benchmark::DoNotOptimize(any.get());
+  }
+  state.SetItemsProcessed(state.iterations() * nb_futures);
+}
+BENCHMARK(BM_when_any)->Arg(3)->RangeMultiplier(8)->Range(1, 4096);
+
+// wait on three pending futures and complete all of them
+void BM_when_all_variadic(benchmark::State& state)
+{
+  for (auto _ : state)
+  {
+    promise<void> prom1, prom2, prom3;
+    auto all =
+        when_all(prom1.get_future(), prom2.get_future(), prom3.get_future());
+    prom1.set_value({});
+    prom2.set_value({});
+    prom3.set_value({});
+    benchmark::DoNotOptimize(all.get());
+  }
+  state.SetItemsProcessed(state.iterations() * 3);
+}
+BENCHMARK(BM_when_all_variadic);
+
+// wait on three pending futures and complete one of them
+void BM_when_any_variadic(benchmark::State& state)
+{
+  for (auto _ : state)
+  {
+    promise<void> prom1, prom2, prom3;
+    auto any =
+        when_any(prom1.get_future(), prom2.get_future(), prom3.get_future());
+    prom2.set_value({});
+    benchmark::DoNotOptimize(any.get());
+  }
+  state.SetItemsProcessed(state.iterations() * 3);
+}
+BENCHMARK(BM_when_any_variadic);
+}
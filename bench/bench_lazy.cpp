@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+
+#include <tconcurrent/executor.hpp>
+#include <tconcurrent/lazy/async.hpp>
+#include <tconcurrent/lazy/sync_wait.hpp>
+#include <tconcurrent/lazy/then.hpp>
+
+using namespace tconcurrent;
+
+namespace
+{
+void BM_lazy_async(benchmark::State& state)
+{
+  lazy::cancelation_token c;
+  auto const sender = lazy::async(get_default_executor());
+  for (auto _ : state)
+    lazy::sync_wait(sender, c);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_lazy_async)->UseRealTime();
+
+void BM_lazy_then_pipeline(benchmark::State& state)
+{
+  lazy::cancelation_token c;
+  auto const sender = lazy::then(
+      lazy::then(
+          lazy::then(lazy::then(lazy::async(get_default_executor()),
+                                [] { return 1; }),
+                     [](int v) { return v + 1; }),
+          [](int v) { return v * 2; }),
+      [](int v) { return v - 1; });
+  for (auto _ : state)
+    benchmark::DoNotOptimize(lazy::sync_wait(sender, c));
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_lazy_then_pipeline)->UseRealTime();
+
+// every step of the pipeline goes back through the executor
+void BM_lazy_connect_pipeline(benchmark::State& state)
+{
+  lazy::cancelation_token c;
+  auto const e = get_default_executor();
+  auto const sender = lazy::connect(
+      lazy::async(e),
+      lazy::connect(lazy::async(e),
+                    lazy::then(lazy::async(e), [] { return 42; })));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(lazy::sync_wait(sender, c));
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_lazy_connect_pipeline)->UseRealTime();
+}
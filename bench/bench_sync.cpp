@@ -0,0 +1,104 @@
+#include <benchmark/benchmark.h>
+
+#include <tconcurrent/concurrent_queue.hpp>
+#include <tconcurrent/lockfree_queue.hpp>
+#include <tconcurrent/semaphore.hpp>
+
+#include <memory>
+
+using namespace tconcurrent;
+
+namespace
+{
+// Every thread pushes and then pops, so pops never have to wait and the
+// benchmark measures the contention on the queue itself.
+template <typename Queue>
+void BM_queue_push_pop(benchmark::State& state)
+{
+  static std::unique_ptr<Queue> queue;
+  if (state.thread_index() == 0)
+    queue = std::make_unique<Queue>();
+  for (auto _ : state)
+  {
+    queue->push(42);
+    benchmark::DoNotOptimize(queue->pop().get());
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0)
+    queue.reset();
+}
+BENCHMARK_TEMPLATE(BM_queue_push_pop, concurrent_queue<int>)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_queue_push_pop, lockfree_queue<int>)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+void BM_lockfree_queue_push_try_pop(benchmark::State& state)
+{
+  static std::unique_ptr<lockfree_queue<int>> queue;
+  if (state.thread_index() == 0)
+    queue = std::make_unique<lockfree_queue<int>>();
+  for (auto _ : state)
+  {
+    queue->push(42);
+    benchmark::DoNotOptimize(queue->try_pop());
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0)
+    queue.reset();
+}
+BENCHMARK(BM_lockfree_queue_push_try_pop)->ThreadRange(1, 8)->UseRealTime();
+
+// push range(0) items and drain them one by one, or in a single batch
+void BM_concurrent_queue_drain_pop(benchmark::State& state)
+{
+  concurrent_queue<int> queue;
+  auto const nb_items = state.range(0);
+  for (auto _ : state)
+  {
+    for (int64_t i = 0; i < nb_items; ++i)
+      queue.push(i);
+    for (int64_t i = 0; i < nb_items; ++i)
+      benchmark::DoNotOptimize(queue.pop().get());
+  }
+  state.SetItemsProcessed(state.iterations() * nb_items);
+}
+BENCHMARK(BM_concurrent_queue_drain_pop)->Arg(1000);
+
+void BM_concurrent_queue_drain_pop_batch(benchmark::State& state)
+{
+  concurrent_queue<int> queue;
+  auto const nb_items = state.range(0);
+  for (auto _ : state)
+  {
+    for (int64_t i = 0; i < nb_items; ++i)
+      queue.push(i);
+    benchmark::DoNotOptimize(queue.pop_batch(nb_items).get());
+  }
+  state.SetItemsProcessed(state.iterations() * nb_items);
+}
+BENCHMARK(BM_concurrent_queue_drain_pop_batch)->Arg(1000);
+
+// range(0) tokens shared by the threads, waiting happens when there are fewer
+// tokens than threads
+void BM_semaphore_acquire_release(benchmark::State& state)
+{
+  static std::unique_ptr<semaphore> sem;
+  if (state.thread_index() == 0)
+    sem = std::make_unique<semaphore>(state.range(0));
+  for (auto _ : state)
+  {
+    sem->acquire().get();
+    sem->release();
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0)
+    sem.reset();
+}
+BENCHMARK(BM_semaphore_acquire_release)
+    ->Arg(1)
+    ->Arg(8)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+}
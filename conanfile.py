@@ -13,6 +13,7 @@ class TconcurrentConan(ConanFile):
         "with_coroutines_ts": [True, False],
         "coverage": [True, False],
         "with_sanitizer_support": [True, False],
+        "with_benchmarks": [True, False],
     }
     default_options = (
         "shared=False",
@@ -20,8 +21,9 @@ class TconcurrentConan(ConanFile):
         "with_coroutines_ts=False",
         "coverage=False",
         "with_sanitizer_support=False",
+        "with_benchmarks=False",
     )
-    exports_sources = "CMakeLists.txt", "src/*", "include/*", "test/*"
+    exports_sources = "CMakeLists.txt", "src/*", "include/*", "test/*", "bench/*"
     generators = "CMakeDeps", "VirtualBuildEnv"
 
     @property
@@ -39,6 +41,8 @@ class TconcurrentConan(ConanFile):
     def build_requirements(self):
         if self.should_build_tests:
             self.test_requires("doctest/2.4.6-r1")
+        if self.options.with_benchmarks:
+            self.test_requires("benchmark/1.8.3")
 
     def configure(self):
         if self.options.with_coroutines_ts and self.settings.compiler != "clang":
@@ -61,6 +65,7 @@ class TconcurrentConan(ConanFile):
         ct.variables["CMAKE_POSITION_INDEPENDENT_CODE"] = self.options.fPIC
         ct.variables["BUILD_TESTING"] = self.should_build_tests
         ct.variables["WITH_COVERAGE"] = self.options.coverage
+        ct.variables["TCONCURRENT_BENCHMARKS"] = self.options.with_benchmarks
         ct.generate()
 
         cd = CMakeDeps(self)
@@ -81,3 +86,4 @@ class TconcurrentConan(ConanFile):
 
     def package_id(self):
         del self.info.options.with_coroutines_ts
+        del self.info.options.with_benchmarks
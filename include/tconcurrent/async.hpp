@@ -9,7 +9,8 @@ namespace tconcurrent
 
 /** Run a task on the given executor
  *
- * \param name (optional) the name of the task, for debugging purposes.
+ * \param name (optional) the name of the task, for debugging purposes. It must
+ * outlive the task, see task_name.
  * \param executor (optional) the executor on which the task will be run
  * \param f the callback to run which must have one of the following signatures:
  *
@@ -19,35 +20,57 @@ namespace tconcurrent
  * \return a future<T> corresponding to the result of the function
  */
 template <typename E, typename F>
-auto async(std::string const& name, E&& executor, F&& f)
+auto async(task_name name, E&& executor, F&& f)
 {
+  static_assert(is_executor_v<std::decay_t<E>>,
+                "E must be an executor, see is_executor");
   using result_type = std::decay_t<packaged_task_result_type<F()>>;
 
   auto pack = package_cancelable<result_type()>(std::forward<F>(f));
 
   executor.post(std::move(std::get<0>(pack)),
-                name + " (" + typeid(F).name() + ")");
-  return std::move(std::get<1>(pack)).update_chain_name(name);
+                task_name(name.name(), &typeid(F)));
+  return std::move(std::get<1>(pack)).update_chain_name(name.name());
 }
 
-/// See async(std::string const& name, E&& executor, F&& f)
+/** Run a task on the given executor with the given priority
+ *
+ * See async(task_name name, E&& executor, F&& f). Executors that do not
+ * support priorities ignore it.
+ */
+template <typename E, typename F>
+auto async(task_name name, E&& executor, task_priority priority, F&& f)
+{
+  return async(name,
+               prioritized_executor(std::forward<E>(executor), priority),
+               std::forward<F>(f));
+}
+
+/// See async(task_name name, E&& executor, task_priority priority, F&& f)
+template <typename E, typename F>
+auto async(E&& executor, task_priority priority, F&& f)
+{
+  return async({}, std::forward<E>(executor), priority, std::forward<F>(f));
+}
+
+/// See async(task_name name, E&& executor, F&& f)
 template <typename F>
-auto async(std::string const& name, F&& f)
+auto async(task_name name, F&& f)
 {
   return async(name, get_default_executor(), std::forward<F>(f));
 }
 
-/// See async(std::string const& name, E&& executor, F&& f)
+/// See async(task_name name, E&& executor, F&& f)
 template <typename E,
           typename F,
           typename = std::enable_if_t<
-              !std::is_convertible<std::decay_t<E>, std::string>::value>>
+              !std::is_convertible<std::decay_t<E>, task_name>::value>>
 auto async(E&& executor, F&& f)
 {
   return async({}, std::forward<E>(executor), std::forward<F>(f));
 }
 
-/// See async(std::string const& name, E&& executor, F&& f)
+/// See async(task_name name, E&& executor, F&& f)
 template <typename F>
 auto async(F&& f)
 {
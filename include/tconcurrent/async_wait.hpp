@@ -13,17 +13,31 @@ namespace tconcurrent
 
 /** Return a future that will be ready in \p delay
  *
- * The returned future is cancelable. If the executor is single threaded, a
- * cancelation request will immediately put the future in a canceled state.
+ * The future may get ready up to \p slack later than that, which lets timers
+ * whose deadlines are close to each other wake up the executor only once.
+ *
+ * The returned future is cancelable. A cancelation request immediately puts
+ * the future in a canceled state, on any executor, unless the timer is already
+ * firing, in which case the future gets ready normally.
  */
 TCONCURRENT_EXPORT
 future<void> async_wait(executor executor,
-                        std::chrono::steady_clock::duration delay);
+                        std::chrono::steady_clock::duration delay,
+                        std::chrono::steady_clock::duration slack =
+                            std::chrono::steady_clock::duration::zero());
 
 inline future<void> async_wait(std::chrono::steady_clock::duration delay)
 {
   return async_wait(get_default_executor(), delay);
 }
+
+// A template so that an lvalue delay does not convert to an executor
+template <typename Rep, typename Period>
+future<void> async_wait(std::chrono::duration<Rep, Period> delay,
+                        std::chrono::steady_clock::duration slack)
+{
+  return async_wait(get_default_executor(), delay, slack);
+}
 }
 
 #endif
@@ -0,0 +1,62 @@
+#ifndef TCONCURRENT_BLOCKING_REGION_HPP
+#define TCONCURRENT_BLOCKING_REGION_HPP
+
+#include <tconcurrent/detail/export.hpp>
+
+namespace tconcurrent
+{
+namespace detail
+{
+/// Execution context that can compensate for its threads being blocked
+class blocking_handler
+{
+public:
+  virtual void enter_blocking() = 0;
+  virtual void leave_blocking() = 0;
+
+protected:
+  ~blocking_handler() = default;
+};
+
+/// Handler of the execution context running the current thread, if any
+TCONCURRENT_EXPORT blocking_handler*& current_blocking_handler();
+}
+
+/** Scope in which the current thread blocks without running tasks
+ *
+ * When the current thread belongs to an execution context that supports it
+ * (a multi-threaded thread_pool), that context starts or wakes up a
+ * compensation thread for the duration of the region so that its other tasks
+ * keep running. Elsewhere, this does nothing.
+ *
+ * future::get() and wait() enter such a region by themselves when they have to
+ * block. Regions nest, only the outermost one is reported.
+ */
+class blocking_region
+{
+public:
+  blocking_region() : _handler(detail::current_blocking_handler())
+  {
+    if (!_handler)
+      return;
+    detail::current_blocking_handler() = nullptr;
+    _handler->enter_blocking();
+  }
+
+  blocking_region(blocking_region const&) = delete;
+  blocking_region& operator=(blocking_region const&) = delete;
+
+  ~blocking_region()
+  {
+    if (!_handler)
+      return;
+    _handler->leave_blocking();
+    detail::current_blocking_handler() = _handler;
+  }
+
+private:
+  detail::blocking_handler* _handler;
+};
+}
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef TCONCURRENT_CANCELATION_TOKEN_HPP
 #define TCONCURRENT_CANCELATION_TOKEN_HPP
 
+#include <tconcurrent/detail/node_pool.hpp>
 #include <tconcurrent/operation_canceled.hpp>
 
 #include <function2/function2.hpp>
@@ -114,7 +115,8 @@ private:
   mutable mutex _mutex;
 
   bool _is_cancel_requested{false};
-  std::deque<cancelation_callback> _do_cancels;
+  std::deque<cancelation_callback, detail::pool_allocator<cancelation_callback>>
+      _do_cancels;
 };
 
 using cancelation_token_ptr = std::shared_ptr<cancelation_token>;
@@ -1,50 +1,241 @@
 #ifndef TCONCURRENT_CHANNEL_HPP
 #define TCONCURRENT_CHANNEL_HPP
 
+#include <algorithm>
 #include <cassert>
+#include <limits>
 #include <mutex>
+#include <optional>
 #include <queue>
+#include <stdexcept>
+#include <utility>
+#include <variant>
 #include <vector>
 
 #include <tconcurrent/promise.hpp>
 
 namespace tconcurrent
 {
+/// Error of the operations on a closed concurrent_queue
+struct queue_closed : std::runtime_error
+{
+  queue_closed() : runtime_error("queue is closed")
+  {
+  }
+};
 
+/** Multi-producer multi-consumer FIFO queue
+ *
+ * pop() returns a future that is ready as soon as there is an item for it.
+ * pop_batch() takes all the items that are available at once, up to a given
+ * number, and only waits when there are none.
+ *
+ * The queue is unbounded by default. When it is given a capacity,
+ * async_push() returns a future that only gets ready once the item fits in the
+ * queue, so that producers can wait for consumers to catch up. The items that
+ * wait for room are not counted in size() and are queued in the order they
+ * were pushed. push() does not tell when its item gets in, and try_push()
+ * never waits.
+ *
+ * Once close() is called, nothing can be pushed anymore, but the items that are
+ * already in the queue can still be popped. next() ends the stream with an
+ * empty optional when the queue is closed and drained, so that a consumer can
+ * be written as:
+ *
+ *     while (auto item = TC_AWAIT(queue.next()))
+ *       process(*item);
+ */
 template <typename T>
 class concurrent_queue
 {
 public:
+  static constexpr std::size_t unbounded =
+      std::numeric_limits<std::size_t>::max();
+
+  concurrent_queue() = default;
+  explicit concurrent_queue(std::size_t capacity) : _capacity(capacity)
+  {
+    assert(capacity > 0);
+  }
+
+  /** Push \p val
+   *
+   * If the queue is bounded and full, the item waits for room like with
+   * async_push().
+   *
+   * \throw queue_closed if the queue is closed
+   */
   void push(T val)
   {
-    scope_lock l(_mutex);
-    if (!_waiters.empty())
+    if (do_push(std::move(val), nullptr) == push_result::closed)
+      throw queue_closed{};
+  }
+
+  /** Push \p val, the returned future is ready when it fits in the queue
+   *
+   * The future finishes with queue_closed if the queue is closed before.
+   */
+  future<void> async_push(T val)
+  {
+    future<void> room;
+    switch (do_push(std::move(val), &room))
     {
-      assert(_queue.empty());
-      _waiters.front().set_value(std::move(val));
-      _waiters.pop();
+    case push_result::closed:
+      return make_exceptional_future<void>(queue_closed{});
+    case push_result::waiting:
+      return room;
+    default:
+      return make_ready_future();
     }
-    else
+  }
+
+  /** Push \p val if it fits in the queue
+   *
+   * \p val is only moved from when the function returns true, it returns
+   * false when the queue is full or closed.
+   */
+  bool try_push(T&& val)
+  {
+    std::optional<waiter> popper;
     {
-      _queue.emplace(std::move(val));
+      scope_lock l(_mutex);
+      if (_closed)
+        return false;
+      if (!_waiters.empty())
+      {
+        assert(_queue.empty());
+        popper.emplace(std::move(_waiters.front()));
+        _waiters.pop();
+      }
+      else if (_queue.size() < _capacity)
+      {
+        _queue.emplace(std::move(val));
+        return true;
+      }
+      else
+      {
+        return false;
+      }
     }
+    give(*popper, std::move(val));
+    return true;
+  }
+
+  bool try_push(T const& val)
+  {
+    T copy(val);
+    return try_push(std::move(copy));
   }
+
+  /// The returned future finishes with queue_closed when the queue is closed
+  /// and drained
   future<T> pop()
   {
-    scope_lock l(_mutex);
-    if (!_queue.empty())
+    std::optional<promise<void>> pusher;
+    future<T> ret;
+    {
+      scope_lock l(_mutex);
+      if (_queue.empty() && _closed)
+        return make_exceptional_future<T>(queue_closed{});
+      if (_queue.empty())
+        return park<T>();
+
+      assert(_waiters.empty());
+      ret = make_ready_future(std::move(_queue.front()));
+      _queue.pop();
+      pusher = admit_pusher();
+    }
+    if (pusher)
+      pusher->set_value({});
+    return ret;
+  }
+
+  /** Pop all the available items, up to \p max_n
+   *
+   * The returned future is ready right away when the queue is not empty,
+   * otherwise it gets ready with the first pushed item. The vector is empty
+   * when the queue is closed and drained.
+   */
+  future<std::vector<T>> pop_batch(std::size_t max_n)
+  {
+    assert(max_n > 0);
+
+    std::vector<promise<void>> pushers;
+    std::vector<T> items;
+    {
+      scope_lock l(_mutex);
+      if (_queue.empty() && _closed)
+        return make_ready_future(std::vector<T>{});
+      if (_queue.empty())
+        return park<std::vector<T>>();
+
+      assert(_waiters.empty());
+      auto const n = std::min(max_n, _queue.size());
+      items.reserve(n);
+      for (std::size_t i = 0; i < n; ++i)
+      {
+        items.push_back(std::move(_queue.front()));
+        _queue.pop();
+      }
+      while (auto pusher = admit_pusher())
+        pushers.push_back(std::move(*pusher));
+    }
+    for (auto& pusher : pushers)
+      pusher.set_value({});
+    return make_ready_future(std::move(items));
+  }
+
+  /// Like pop(), but the end of the stream is an empty optional instead of an
+  /// error
+  future<std::optional<T>> next()
+  {
+    std::optional<promise<void>> pusher;
+    future<std::optional<T>> ret;
     {
+      scope_lock l(_mutex);
+      if (_queue.empty() && _closed)
+        return make_ready_future(std::optional<T>{});
+      if (_queue.empty())
+        return park<std::optional<T>>();
+
       assert(_waiters.empty());
-      auto ret = make_ready_future(std::move(_queue.front()));
+      ret = make_ready_future(std::optional<T>(std::move(_queue.front())));
       _queue.pop();
-      return ret;
+      pusher = admit_pusher();
     }
-    else
+    if (pusher)
+      pusher->set_value({});
+    return ret;
+  }
+
+  /** Close the queue
+   *
+   * Waiting pops are woken up with the end of the stream, and pushes that
+   * wait for room finish with queue_closed, their items are dropped.
+   */
+  void close()
+  {
+    std::queue<waiter> waiters;
+    std::queue<pending_push> pushers;
     {
-      promise<T> prom;
-      _waiters.emplace(prom);
-      return prom.get_future();
+      scope_lock l(_mutex);
+      if (_closed)
+        return;
+      _closed = true;
+      std::swap(waiters, _waiters);
+      std::swap(pushers, _pushers);
     }
+    for (; !waiters.empty(); waiters.pop())
+      end_of_stream(waiters.front());
+    for (; !pushers.empty(); pushers.pop())
+      pushers.front().prom.set_exception(
+          std::make_exception_ptr(queue_closed{}));
+  }
+
+  bool is_closed() const
+  {
+    scope_lock l(_mutex);
+    return _closed;
   }
 
   std::size_t size() const
@@ -53,12 +244,115 @@ public:
     return _queue.size();
   }
 
+  std::size_t capacity() const
+  {
+    return _capacity;
+  }
+
 private:
   using mutex_t = std::mutex;
   using scope_lock = std::lock_guard<mutex_t>;
+
+  struct pending_push
+  {
+    T val;
+    promise<void> prom;
+  };
+
+  // a pop(), a pop_batch() or a next()
+  using waiter = std::variant<promise<T>,
+                              promise<std::vector<T>>,
+                              promise<std::optional<T>>>;
+
+  std::size_t const _capacity = unbounded;
   mutable mutex_t _mutex;
-  std::queue<promise<T>> _waiters;
+  std::queue<waiter> _waiters;
   std::queue<T> _queue;
+  // items that wait for room in the queue when it is bounded
+  std::queue<pending_push> _pushers;
+  bool _closed = false;
+
+  enum class push_result
+  {
+    done,
+    waiting,
+    closed,
+  };
+
+  // \p room is set to a future that gets ready when the item is in the queue
+  // if it has to wait, and if it is not null
+  push_result do_push(T&& val, future<void>* room)
+  {
+    std::optional<waiter> popper;
+    {
+      scope_lock l(_mutex);
+      if (_closed)
+        return push_result::closed;
+      if (!_waiters.empty())
+      {
+        assert(_queue.empty());
+        popper.emplace(std::move(_waiters.front()));
+        _waiters.pop();
+      }
+      else if (_queue.size() < _capacity)
+      {
+        _queue.emplace(std::move(val));
+        return push_result::done;
+      }
+      else
+      {
+        _pushers.push({std::move(val), {}});
+        if (room)
+          *room = _pushers.back().prom.get_future();
+        return push_result::waiting;
+      }
+    }
+    give(*popper, std::move(val));
+    return push_result::done;
+  }
+
+  // must be called with the lock held
+  template <typename R>
+  future<R> park()
+  {
+    assert(_pushers.empty());
+    promise<R> prom;
+    _waiters.emplace(prom);
+    return prom.get_future();
+  }
+
+  // must be called with the lock held, move the oldest waiting item in the
+  // queue if there is room for it
+  std::optional<promise<void>> admit_pusher()
+  {
+    if (_pushers.empty() || _queue.size() >= _capacity)
+      return std::nullopt;
+    auto& front = _pushers.front();
+    _queue.emplace(std::move(front.val));
+    auto prom = std::move(front.prom);
+    _pushers.pop();
+    return prom;
+  }
+
+  static void give(waiter& w, T val)
+  {
+    if (auto const prom = std::get_if<promise<T>>(&w))
+      return prom->set_value(std::move(val));
+    if (auto const prom = std::get_if<promise<std::optional<T>>>(&w))
+      return prom->set_value(std::move(val));
+    std::vector<T> items;
+    items.push_back(std::move(val));
+    std::get<promise<std::vector<T>>>(w).set_value(std::move(items));
+  }
+
+  static void end_of_stream(waiter& w)
+  {
+    if (auto const prom = std::get_if<promise<T>>(&w))
+      return prom->set_exception(std::make_exception_ptr(queue_closed{}));
+    if (auto const prom = std::get_if<promise<std::optional<T>>>(&w))
+      return prom->set_value(std::nullopt);
+    std::get<promise<std::vector<T>>>(w).set_value({});
+  }
 };
 }
 
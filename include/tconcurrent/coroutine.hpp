@@ -30,7 +30,7 @@ namespace lazy
  * result
  */
 template <typename E, typename F, typename... Args>
-auto run_resumable(E&& executor, std::string name, F&& cb, Args&&... args);
+auto run_resumable(E&& executor, task_name name, F&& cb, Args&&... args);
 
 /** Return a sender that will run the resumable function on the provided
  * executor.
@@ -41,7 +41,7 @@ auto run_resumable(E&& executor, std::string name, F&& cb, Args&&... args);
  * - The function is allowed to capture state
  */
 template <typename E, typename F>
-auto async_resumable(E&& executor, std::string const& name, F&& cb);
+auto async_resumable(E&& executor, task_name name, F&& cb);
 
 /** Return a sender that will run the resumable function on the default
  * executor.
@@ -67,7 +67,7 @@ auto async_resumable(F&& cb)
  * \return a future<T> corresponding to the result of the callback
  */
 template <typename E, typename F>
-auto async_resumable(std::string const& name, E&& executor, F&& cb)
+auto async_resumable(task_name name, E&& executor, F&& cb)
 {
   using return_task_type = std::decay_t<decltype(cb())>;
   using return_type = typename detail::task_return_type<return_task_type>::type;
@@ -76,16 +76,16 @@ auto async_resumable(std::string const& name, E&& executor, F&& cb)
       std::forward<E>(executor), name, std::forward<F>(cb)));
 }
 
-/// See auto async_resumable(std::string const& name, E&& executor, F&& cb)
+/// See auto async_resumable(task_name name, E&& executor, F&& cb)
 template <typename F>
 auto async_resumable(F&& cb)
 {
   return async_resumable({}, get_default_executor(), std::forward<F>(cb));
 }
 
-/// See auto async_resumable(std::string const& name, E&& executor, F&& cb)
+/// See auto async_resumable(task_name name, E&& executor, F&& cb)
 template <typename F>
-auto async_resumable(std::string const& name, F&& cb)
+auto async_resumable(task_name name, F&& cb)
 {
   return async_resumable(name, get_default_executor(), std::forward<F>(cb));
 }
@@ -0,0 +1,142 @@
+#ifndef TCONCURRENT_DETAIL_MPMC_QUEUE_HPP
+#define TCONCURRENT_DETAIL_MPMC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace tconcurrent
+{
+namespace detail
+{
+/** Bounded lock-free multi-producer multi-consumer FIFO queue
+ *
+ * This is Dmitry Vyukov's bounded MPMC queue: a ring of cells, each with a
+ * sequence number that tells whether it is free for the producer or ready for
+ * the consumer of a given turn. Producers and consumers each claim a position
+ * with a CAS, then fill or empty the cell and publish it by bumping its
+ * sequence number.
+ *
+ * All the cells are allocated at construction, push and pop never allocate.
+ * try_push fails when the queue is full and try_pop when it is empty, or when
+ * the producer of the next cell has claimed it but not filled it yet.
+ */
+template <typename T>
+class mpmc_queue
+{
+public:
+  /// \p capacity is rounded up to a power of two
+  explicit mpmc_queue(std::size_t capacity)
+    : _mask(round_up_to_power_of_2(capacity) - 1),
+      _cells(std::make_unique<cell[]>(_mask + 1))
+  {
+    for (std::size_t i = 0; i <= _mask; ++i)
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  mpmc_queue(mpmc_queue const&) = delete;
+  mpmc_queue& operator=(mpmc_queue const&) = delete;
+
+  ~mpmc_queue()
+  {
+    while (try_pop())
+      ;
+  }
+
+  std::size_t capacity() const
+  {
+    return _mask + 1;
+  }
+
+  /// False when a producer has claimed a cell that was not popped yet, even
+  /// if it is not filled
+  bool empty() const
+  {
+    auto const pop_pos = _pop_pos.load(std::memory_order_acquire);
+    return pop_pos == _push_pos.load(std::memory_order_acquire);
+  }
+
+  /// Leaves \p value untouched and returns false when the queue is full
+  bool try_push(T& value)
+  {
+    auto pos = _push_pos.load(std::memory_order_relaxed);
+    while (true)
+    {
+      auto& c = _cells[pos & _mask];
+      auto const seq = c.sequence.load(std::memory_order_acquire);
+      auto const diff =
+          static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0)
+      {
+        if (_push_pos.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed))
+        {
+          new (&c.storage) T(std::move(value));
+          c.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (diff < 0)
+        return false;
+      else
+        pos = _push_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  std::optional<T> try_pop()
+  {
+    auto pos = _pop_pos.load(std::memory_order_relaxed);
+    while (true)
+    {
+      auto& c = _cells[pos & _mask];
+      auto const seq = c.sequence.load(std::memory_order_acquire);
+      auto const diff = static_cast<std::ptrdiff_t>(seq) -
+                        static_cast<std::ptrdiff_t>(pos + 1);
+      if (diff == 0)
+      {
+        if (_pop_pos.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed))
+        {
+          auto const p = std::launder(reinterpret_cast<T*>(&c.storage));
+          std::optional<T> value(std::move(*p));
+          p->~T();
+          c.sequence.store(pos + _mask + 1, std::memory_order_release);
+          return value;
+        }
+      }
+      else if (diff < 0)
+        return std::nullopt;
+      else
+        pos = _pop_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+private:
+  struct cell
+  {
+    std::atomic<std::size_t> sequence;
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage;
+  };
+
+  static std::size_t round_up_to_power_of_2(std::size_t n)
+  {
+    std::size_t p = 2;
+    while (p < n)
+      p *= 2;
+    return p;
+  }
+
+  std::size_t const _mask;
+  std::unique_ptr<cell[]> const _cells;
+  // producers and consumers each get their own cache line
+  alignas(64) std::atomic<std::size_t> _push_pos{0};
+  alignas(64) std::atomic<std::size_t> _pop_pos{0};
+};
+}
+}
+
+#endif
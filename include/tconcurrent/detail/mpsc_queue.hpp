@@ -0,0 +1,109 @@
+#ifndef TCONCURRENT_DETAIL_MPSC_QUEUE_HPP
+#define TCONCURRENT_DETAIL_MPSC_QUEUE_HPP
+
+#include <tconcurrent/detail/node_pool.hpp>
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace tconcurrent
+{
+namespace detail
+{
+/** Unbounded lock-free multi-producer single-consumer FIFO queue
+ *
+ * This is Dmitry Vyukov's intrusive MPSC queue: producers only exchange the
+ * head and then link the previous one, the consumer walks the list from the
+ * tail. A stub node is put back in the list when it gets empty so that the
+ * last node can be popped.
+ *
+ * A push is a single atomic exchange and never blocks. A pop may fail even
+ * though the queue is not empty when a producer was preempted between the
+ * exchange and the link: the nodes pushed after it are not reachable until it
+ * finishes.
+ */
+template <typename T>
+class mpsc_queue
+{
+public:
+  mpsc_queue() = default;
+  mpsc_queue(mpsc_queue const&) = delete;
+  mpsc_queue& operator=(mpsc_queue const&) = delete;
+
+  ~mpsc_queue()
+  {
+    while (try_pop())
+      ;
+  }
+
+  /// Can be called from any thread
+  void push(T value)
+  {
+    push_node(new node(std::move(value)));
+  }
+
+  /// Must only be called by one thread at a time
+  std::optional<T> try_pop()
+  {
+    auto tail = _tail;
+    auto next = tail->next.load(std::memory_order_acquire);
+    if (tail == &_stub)
+    {
+      if (!next)
+        return std::nullopt;
+      _tail = tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next)
+    {
+      _tail = next;
+      return take(tail);
+    }
+    // tail is the last linked node, but a push may be in progress
+    if (tail != _head.load(std::memory_order_acquire))
+      return std::nullopt;
+    _stub.next.store(nullptr, std::memory_order_relaxed);
+    push_node(&_stub);
+    next = tail->next.load(std::memory_order_acquire);
+    if (!next)
+      return std::nullopt;
+    _tail = next;
+    return take(tail);
+  }
+
+private:
+  struct node : pooled
+  {
+    std::atomic<node*> next{nullptr};
+    std::optional<T> value;
+
+    node() = default;
+    explicit node(T&& value) : value(std::move(value))
+    {
+    }
+  };
+
+  node _stub;
+  // producers side, the last pushed node
+  std::atomic<node*> _head{&_stub};
+  // consumer side, the next node to pop
+  node* _tail{&_stub};
+
+  void push_node(node* n)
+  {
+    auto const previous = _head.exchange(n, std::memory_order_acq_rel);
+    previous->next.store(n, std::memory_order_release);
+  }
+
+  static std::optional<T> take(node* n)
+  {
+    std::optional<T> value(std::move(n->value));
+    delete n;
+    return value;
+  }
+};
+}
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef TCONCURRENT_DETAIL_NODE_POOL_HPP
+#define TCONCURRENT_DETAIL_NODE_POOL_HPP
+
+#include <tconcurrent/detail/export.hpp>
+
+#include <function2/function2.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace tconcurrent
+{
+namespace detail
+{
+/** Allocate a block of at least \p size bytes from the pool of this thread
+ *
+ * Blocks of up to max_pooled_size bytes come from per-thread free lists
+ * split in size classes. When a free list grows too large, or when its thread
+ * exits, a batch of blocks goes to a shared depot where the threads whose list
+ * is empty take them back, so that blocks allocated on one thread and freed on
+ * another are still reused. Bigger blocks come from operator new.
+ *
+ * The block must be released by pool_deallocate() with the same size, on any
+ * thread.
+ */
+TCONCURRENT_EXPORT void* pool_allocate(std::size_t size);
+TCONCURRENT_EXPORT void pool_deallocate(void* p, std::size_t size) noexcept;
+
+constexpr std::size_t max_pooled_size = 1024;
+
+/// Standard allocator that allocates from the pool
+template <typename T>
+class pool_allocator
+{
+public:
+  using value_type = T;
+
+  pool_allocator() = default;
+  template <typename U>
+  pool_allocator(pool_allocator<U> const&) noexcept
+  {
+  }
+
+  T* allocate(std::size_t n)
+  {
+    if constexpr (alignof(T) > alignof(std::max_align_t))
+      return std::allocator<T>().allocate(n);
+    else
+      return static_cast<T*>(pool_allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept
+  {
+    if constexpr (alignof(T) > alignof(std::max_align_t))
+      std::allocator<T>().deallocate(p, n);
+    else
+      pool_deallocate(p, n * sizeof(T));
+  }
+
+  template <typename U>
+  bool operator==(pool_allocator<U> const&) const noexcept
+  {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(pool_allocator<U> const&) const noexcept
+  {
+    return false;
+  }
+};
+
+/// std::make_shared, but allocating from the pool
+template <typename T, typename... Args>
+std::shared_ptr<T> make_pooled_shared(Args&&... args)
+{
+  return std::allocate_shared<T>(pool_allocator<T>(),
+                                 std::forward<Args>(args)...);
+}
+
+/// Base class of the types that are allocated from the pool with new
+struct pooled
+{
+  static void* operator new(std::size_t size)
+  {
+    return pool_allocate(size);
+  }
+
+  static void operator delete(void* p, std::size_t size) noexcept
+  {
+    pool_deallocate(p, size);
+  }
+};
+
+/** Inline capacity of the functions that futures and tasks store
+ *
+ * It is large enough for a continuation with its executor and task name, and
+ * for lambdas that capture a few pointers or shared_ptrs. Bigger callables
+ * are allocated separately.
+ */
+constexpr std::size_t task_inline_capacity = 64;
+
+template <typename Signature>
+using task_function =
+    fu2::function_base<true,
+                       false,
+                       fu2::capacity_fixed<task_inline_capacity>,
+                       true,
+                       false,
+                       Signature>;
+}
+}
+
+#endif
@@ -3,17 +3,21 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <mutex>
 #include <stdexcept>
-#include <string>
-#include <vector>
+#include <thread>
 
 #include <function2/function2.hpp>
 
 #include <boost/variant2/variant.hpp>
 
+#include <tconcurrent/blocking_region.hpp>
 #include <tconcurrent/cancelation_token.hpp>
+#include <tconcurrent/detail/node_pool.hpp>
 #include <tconcurrent/detail/tvoid.hpp>
+#include <tconcurrent/executor.hpp>
+#include <tconcurrent/task_name.hpp>
 
 namespace tconcurrent
 {
@@ -108,7 +112,7 @@ public:
   template <typename... Args>
   static promise_ptr make_shared(Args&&... args)
   {
-    auto p = std::make_shared<S>(std::forward<Args>(args)...);
+    auto p = make_pooled_shared<S>(std::forward<Args>(args)...);
     ++p->_promise_count;
     return promise_ptr(std::move(p));
   }
@@ -131,12 +135,22 @@ private:
   }
 };
 
-struct nocancel_tag
+/** What a continuation asks to the state it is chained to
+ *
+ * A continuation only keeps a weak reference to that state, the token of the
+ * chain is looked up through it when someone needs one.
+ */
+class token_source
 {
+public:
+  virtual ~token_source() = default;
+
+  virtual cancelation_token_ptr get_cancelation_token() = 0;
+  virtual bool is_cancel_requested() const = 0;
 };
 
 template <typename R>
-class shared_base
+class shared_base : public token_source
 {
 public:
   struct v_none
@@ -151,22 +165,29 @@ public:
     std::exception_ptr exc;
   };
 
+  /** The result, it must only be read once is_ready() returned true
+   */
   boost::variant2::variant<v_none, v_value, v_exception> _r;
 
-  shared_base(nocancel_tag)
+  /// The cancelation token is created on first use if \p token is null
+  shared_base(cancelation_token_ptr token = nullptr)
+    : _token(token ? new token_box(std::move(token)) : nullptr)
   {
   }
 
-  shared_base(cancelation_token_ptr token = nullptr)
-    : _cancelation_token(token ? std::move(token)
-                               : std::make_shared<cancelation_token>())
+  /// The cancelation token is taken from \p parent on first use, if it is
+  /// still pending by then
+  shared_base(std::weak_ptr<token_source> parent)
+    : _token(nullptr), _parent(std::move(parent))
   {
   }
 
   virtual ~shared_base()
   {
     assert(_promise_count.load() == 0);
-    assert(_r.index() != 0);
+    assert(is_ready());
+    delete _waiter.load(std::memory_order_relaxed);
+    delete _token.load(std::memory_order_relaxed);
   }
 
   void set(R const& r)
@@ -183,25 +204,38 @@ public:
     finish([&] { _r = v_exception{exc}; });
   }
 
+  bool is_ready() const noexcept
+  {
+    return _continuations.load(std::memory_order_acquire) == ready_tag();
+  }
+
   template <typename E, typename F>
-  void then(std::string name, E&& e, F&& f)
+  void then(task_name name, E&& e, F&& f)
   {
-    bool resolved{false};
+    static_assert(is_executor_v<std::decay_t<E>>,
+                  "E must be an executor, see is_executor");
 
+    if (is_ready())
     {
-      std::lock_guard<std::mutex> lock{_mutex};
-      if (_r.index() == 0)
-        _then.emplace_back([name = std::move(name),
-                            e = std::forward<E>(e),
-                            f = std::forward<F>(f)]() mutable {
-          e.post(std::move(f), std::move(name));
-        });
-      else
-        resolved = true;
+      e.post(std::forward<F>(f), name);
+      return;
     }
 
-    if (resolved)
-      e.post(std::forward<F>(f), std::move(name));
+    // Only the first continuation is stored inline, which is the usual case of
+    // a future chain
+    auto const c = _first_continuation_taken.exchange(true)
+                       ? new continuation
+                       : &_first_continuation;
+    c->run = [name,
+              e = stored_executor_t<E>(std::forward<E>(e)),
+              f = std::forward<F>(f)]() mutable { e.post(std::move(f), name); };
+
+    if (!push_continuation(c))
+    {
+      // we got ready in the meantime
+      c->run();
+      release_continuation(c);
+    }
   }
 
   template <typename Rcv>
@@ -210,9 +244,7 @@ public:
     static_assert(std::is_same<R, std::decay_t<Rcv>>::value,
                   "Rcv must be a R or R const&");
 
-    std::unique_lock<std::mutex> lock{_mutex};
-    while (_r.index() == 0)
-      _ready.wait(lock);
+    wait();
     if (_r.index() == 2)
       std::rethrow_exception(boost::variant2::get<v_exception>(_r).exc);
     // this may or may not move depending on Rcv being a reference or not
@@ -221,9 +253,7 @@ public:
 
   std::exception_ptr const& get_exception()
   {
-    std::unique_lock<std::mutex> lock{_mutex};
-    while (_r.index() == 0)
-      _ready.wait(lock);
+    wait();
     if (_r.index() == 1)
       throw std::logic_error("this future has a value");
     return boost::variant2::get<v_exception>(_r).exc;
@@ -231,45 +261,245 @@ public:
 
   void wait() const
   {
-    std::unique_lock<std::mutex> lock{_mutex};
-    _ready.wait(lock, [&] { return _r.index() != 0; });
+    if (is_ready())
+      return;
+
+    blocking_region region;
+    auto& w = get_waiter();
+    std::unique_lock<std::mutex> lock{w.mutex};
+    w.ready.wait(lock, [&] { return is_ready(); });
   }
 
   template <class Rep, class Period>
   void wait_for(std::chrono::duration<Rep, Period> const& dur) const
   {
-    std::unique_lock<std::mutex> lock{_mutex};
-    _ready.wait_for(lock, dur, [&] { return _r.index() != 0; });
+    if (is_ready())
+      return;
+
+    blocking_region region;
+    auto& w = get_waiter();
+    std::unique_lock<std::mutex> lock{w.mutex};
+    w.ready.wait_for(lock, dur, [&] { return is_ready(); });
   }
 
+  /** Give this state a new cancelation token, unrelated to the chain
+   *
+   * The task keeps the token it would have had before this call.
+   */
   std::shared_ptr<cancelation_token> reset_cancelation_token()
   {
-    std::unique_lock<std::mutex> lock{_mutex};
-    _cancelation_token = std::make_shared<cancelation_token>();
-    return _cancelation_token;
+    auto task_token = get_task_cancelation_token();
+    auto token = make_pooled_shared<cancelation_token>();
+    release_token_box(
+        _token.exchange(new token_box(token, std::move(task_token))));
+    return token;
+  }
+
+  /** Get the cancelation token, creating it if needed
+   *
+   * The token is the one of the parent state if it is still pending. Return
+   * null if the state is ready and nobody asked for a token before.
+   */
+  cancelation_token_ptr get_cancelation_token() override
+  {
+    auto token = load_token(false);
+    if (token || is_ready())
+      return token;
+
+    bool canceled = false;
+    if (auto const parent = _parent.lock())
+    {
+      token = parent->get_cancelation_token();
+      // a ready parent has no token anymore, but it remembers
+      canceled = !token && parent->is_cancel_requested();
+    }
+    if (!token)
+    {
+      token = make_pooled_shared<cancelation_token>();
+      if (canceled)
+        token->request_cancel();
+      // nobody else can see the token yet, anything pushed here stays below
+      // what others push
+      on_token_created(*token);
+    }
+
+    auto const box = new token_box(token);
+    token_box* expected = nullptr;
+    if (!_token.compare_exchange_strong(expected, box))
+    {
+      delete box;
+      return load_token(false);
+    }
+    // finish() may have cleared the token between our check and the exchange,
+    // it would then never clear this one
+    expected = box;
+    if (is_ready() && _token.compare_exchange_strong(expected, nullptr))
+      release_token_box(box);
+    return token;
+  }
+
+  /// Does not create the cancelation token
+  bool is_cancel_requested() const override
+  {
+    return cancel_requested(false);
   }
 
-  std::shared_ptr<cancelation_token> get_cancelation_token()
+  /// The token given to the task, which differs from get_cancelation_token()
+  /// only once the chain was broken by reset_cancelation_token()
+  cancelation_token_ptr get_task_cancelation_token()
   {
-    std::unique_lock<std::mutex> lock{_mutex};
-    return _cancelation_token;
+    if (auto token = load_token(true))
+      return token;
+    return get_cancelation_token();
   }
 
-private:
-  mutable std::mutex _mutex;
-  mutable std::condition_variable _ready;
-  std::vector<fu2::unique_function<void()>> _then;
+  bool is_task_cancel_requested() const
+  {
+    return cancel_requested(true);
+  }
 
 protected:
-  cancelation_token_ptr _cancelation_token;
+  /// Called on a token created for this state, before it is published
+  virtual void on_token_created(cancelation_token&)
+  {
+  }
 
 private:
+  struct continuation : pooled
+  {
+    continuation* next{nullptr};
+    task_function<void()> run;
+  };
+
+  /// Only allocated when someone blocks on the future
+  struct waiter : pooled
+  {
+    std::mutex mutex;
+    std::condition_variable ready;
+  };
+
+  /** The state word
+   *
+   * It is null while the future is pending and has no continuation, then
+   * points to a stack of continuations. It becomes ready_tag() once the result
+   * is set, after which it never changes.
+   */
+  std::atomic<continuation*> _continuations{nullptr};
+  std::atomic<bool> _first_continuation_taken{false};
+  continuation _first_continuation;
+  mutable std::atomic<waiter*> _waiter{nullptr};
+
+  /// Reference to the cancelation token, never modified once published
+  struct token_box : pooled
+  {
+    explicit token_box(cancelation_token_ptr token,
+                       cancelation_token_ptr task_token = nullptr)
+      : token(std::move(token)), task_token(std::move(task_token))
+    {
+    }
+
+    cancelation_token_ptr const token;
+    /// The token of the task if it is not the same, see
+    /// reset_cancelation_token()
+    cancelation_token_ptr const task_token;
+  };
+
+  /** The cancelation token, or null
+   *
+   * A box is unpublished before it is deleted, and it is only deleted once no
+   * thread is in load_token(), which only copies the shared_ptr out of it.
+   */
+  std::atomic<token_box*> _token;
+  mutable std::atomic<unsigned int> _token_readers{0};
+  /// The state this one is chained to, if any
+  std::weak_ptr<token_source> const _parent;
+  /// The answer of is_cancel_requested() once ready, the token is gone by then
+  std::atomic<bool> _chain_canceled{false};
+
   /** Counts the number of promises (or anything that can set the shared state)
    *
    * This count is used to set an error state when all promises are destroyed.
    */
   std::atomic<unsigned int> _promise_count{0};
 
+  cancelation_token_ptr load_token(bool for_task) const
+  {
+    // most states never get a token, don't make them pay for the readers
+    if (!_token.load())
+      return nullptr;
+    ++_token_readers;
+    cancelation_token_ptr token;
+    if (auto const box = _token.load())
+      token = for_task && box->task_token ? box->task_token : box->token;
+    --_token_readers;
+    return token;
+  }
+
+  bool cancel_requested(bool for_task) const
+  {
+    if (auto const token = load_token(for_task))
+      return token->is_cancel_requested();
+    // the token is cleared only after the ready state is published
+    if (is_ready())
+      return _chain_canceled.load(std::memory_order_relaxed);
+    if (auto const parent = _parent.lock())
+      return parent->is_cancel_requested();
+    return false;
+  }
+
+  /// Delete a box that has been unpublished
+  void release_token_box(token_box* box)
+  {
+    if (!box)
+      return;
+    // seq_cst pairs with load_token(), so that a reader that saw the box is
+    // counted here
+    while (_token_readers.load() != 0)
+      std::this_thread::yield();
+    delete box;
+  }
+
+  static continuation* ready_tag() noexcept
+  {
+    return reinterpret_cast<continuation*>(std::uintptr_t{1});
+  }
+
+  bool push_continuation(continuation* c)
+  {
+    auto head = _continuations.load(std::memory_order_acquire);
+    do
+    {
+      if (head == ready_tag())
+        return false;
+      c->next = head;
+    } while (!_continuations.compare_exchange_weak(
+        head, c, std::memory_order_release, std::memory_order_acquire));
+    return true;
+  }
+
+  void release_continuation(continuation* c)
+  {
+    if (c == &_first_continuation)
+      c->run = nullptr;
+    else
+      delete c;
+  }
+
+  waiter& get_waiter() const
+  {
+    auto w = _waiter.load();
+    if (w)
+      return *w;
+
+    auto const created = new waiter;
+    // seq_cst pairs with finish() so that either we see the ready state or it
+    // sees our waiter
+    if (_waiter.compare_exchange_strong(w, created))
+      return *created;
+    delete created;
+    return *w;
+  }
+
   bool increment_promise()
   {
     auto count = _promise_count.load();
@@ -285,26 +515,51 @@ private:
   void decrement_promise()
   {
     assert(_promise_count.load() > 0);
-    if (--_promise_count == 0 && _r.index() == 0)
+    if (--_promise_count == 0 && !is_ready())
       set_exception(std::make_exception_ptr(broken_promise{}));
   }
 
   template <typename F>
   void finish(F&& setval)
   {
-    assert(_r.index() == 0 && "state already set");
+    assert(!is_ready() && "state already set");
 
-    std::vector<fu2::unique_function<void()>> then;
+    setval();
+    // continuations still ask once we are ready, record the answer while the
+    // token and the parent are there
+    if (_token.load() || !_parent.expired())
+      _chain_canceled.store(is_cancel_requested(), std::memory_order_relaxed);
+    // publish the ready state before clearing the token, so that
+    // get_cancelation_token() either sees it or has its token cleared here
+    auto head = _continuations.exchange(ready_tag());
+    release_token_box(_token.exchange(nullptr));
+
+    if (auto const w = _waiter.load())
     {
-      std::lock_guard<std::mutex> lock{_mutex};
-      setval();
-      std::swap(_then, then);
-      _cancelation_token = nullptr;
+      // lock the mutex to make sure the waiter is either not waiting yet and
+      // will see the ready state, or already waiting and will be notified.
+      // Notify under the lock, the waiter may destroy us as soon as it wakes
+      // up.
+      std::lock_guard<std::mutex> lock{w->mutex};
+      w->ready.notify_all();
     }
 
-    _ready.notify_all();
-    for (auto& f : then)
-      f();
+    // continuations were pushed on a stack, run them in registration order
+    continuation* list = nullptr;
+    while (head)
+    {
+      auto const next = head->next;
+      head->next = list;
+      list = head;
+      head = next;
+    }
+    while (list)
+    {
+      auto const next = list->next;
+      list->run();
+      release_continuation(list);
+      list = next;
+    }
   }
 
   template <typename S>
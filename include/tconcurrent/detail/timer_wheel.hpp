@@ -0,0 +1,107 @@
+#ifndef TCONCURRENT_DETAIL_TIMER_WHEEL_HPP
+#define TCONCURRENT_DETAIL_TIMER_WHEEL_HPP
+
+#include <tconcurrent/detail/export.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace tconcurrent
+{
+namespace detail
+{
+class timer_wheel;
+
+/** Timer that can be armed on a timer_wheel
+ *
+ * The wheel keeps the timer alive while it is armed. Allocate it with
+ * make_pooled_shared() so that arming timers does not hit operator new.
+ */
+class TCONCURRENT_EXPORT timer_node
+{
+public:
+  timer_node() = default;
+  timer_node(timer_node const&) = delete;
+  timer_node& operator=(timer_node const&) = delete;
+  virtual ~timer_node() = default;
+
+protected:
+  /// Called once on a thread of the wheel's io_context when the timer expires
+  virtual void fire() = 0;
+
+private:
+  friend timer_wheel;
+
+  static constexpr std::size_t no_bucket = static_cast<std::size_t>(-1);
+
+  timer_node* _prev = nullptr;
+  timer_node* _next = nullptr;
+  std::size_t _bucket = no_bucket;
+  std::uint64_t _expiry = 0;
+  std::shared_ptr<timer_node> _self;
+};
+
+/** Hierarchical timing wheel of an io_context
+ *
+ * Time is counted in ticks of one millisecond. The timers are in intrusive
+ * lists in slots of several levels, each level being 64 times coarser than
+ * the previous one, and are moved down a level when the time reaches their
+ * slot, so that arming and canceling a timer are O(1) whatever the number of
+ * timers. A single asio timer wakes the wheel up for the next slot to process.
+ *
+ * Timers never fire early, and fire late by less than a tick on top of the
+ * latency of the io_context.
+ */
+class TCONCURRENT_EXPORT timer_wheel : public boost::asio::io_context::service
+{
+public:
+  using clock = std::chrono::steady_clock;
+
+  static boost::asio::io_context::id id;
+
+  /// Get the wheel of \p io, it is created on first use
+  static timer_wheel& get(boost::asio::io_context& io);
+
+  explicit timer_wheel(boost::asio::io_context& io);
+  ~timer_wheel() override;
+
+  /** Arm \p timer to fire at \p deadline, it must not be armed already
+   *
+   * The timer may fire up to \p slack after the deadline. The wheel then picks
+   * the tick of that window that is a multiple of the highest power of two,
+   * so that the timers whose windows overlap fire together with a single
+   * wake-up.
+   */
+  void arm(std::shared_ptr<timer_node> timer,
+           clock::time_point deadline,
+           clock::duration slack = clock::duration::zero());
+
+  /** Disarm \p timer
+   *
+   * Return false if it already fired or is firing, in which case fire() is
+   * called or will be called.
+   *
+   * The wheel releases its reference to the timer, so the caller must hold its
+   * own.
+   */
+  bool cancel(timer_node& timer);
+
+  /// Number of armed timers
+  std::size_t size() const;
+
+private:
+  struct impl;
+
+  std::unique_ptr<impl> _impl;
+
+  void on_driver();
+  void shutdown() override;
+};
+}
+}
+
+#endif
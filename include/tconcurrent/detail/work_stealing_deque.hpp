@@ -0,0 +1,157 @@
+#ifndef TCONCURRENT_DETAIL_WORK_STEALING_DEQUE_HPP
+#define TCONCURRENT_DETAIL_WORK_STEALING_DEQUE_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace tconcurrent
+{
+namespace detail
+{
+/** Chase-Lev work-stealing deque
+ *
+ * Only the owner thread may call push() and pop(), which operate on the bottom
+ * of the deque in LIFO order. Any thread may call steal(), which takes from the
+ * top in FIFO order.
+ *
+ * This is the version described in "Correct and Efficient Work-Stealing for
+ * Weak Memory Models" (Lê, Pop, Cohen, Zappa Nardelli, 2013). Buffers that are
+ * replaced when growing are kept until the deque is destroyed because a thief
+ * may still be reading them.
+ */
+template <typename T>
+class work_stealing_deque
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+                "work_stealing_deque elements must be trivially copyable");
+
+public:
+  /// \p capacity must be a power of two
+  explicit work_stealing_deque(std::int64_t capacity = 256)
+  {
+    assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+    _buffers.push_back(std::make_unique<buffer>(capacity));
+    _buffer.store(_buffers.back().get(), std::memory_order_relaxed);
+  }
+
+  work_stealing_deque(work_stealing_deque const&) = delete;
+  work_stealing_deque& operator=(work_stealing_deque const&) = delete;
+
+  /// Push an element at the bottom, must be called by the owner
+  void push(T value)
+  {
+    auto const b = _bottom.load(std::memory_order_relaxed);
+    auto const t = _top.load(std::memory_order_acquire);
+    auto a = _buffer.load(std::memory_order_relaxed);
+    if (b - t > a->capacity - 1)
+      a = grow(a, b, t);
+    a->put(b, value);
+    // the paper uses a release fence and a relaxed store, a release store is
+    // equivalent and is understood by thread sanitizer
+    _bottom.store(b + 1, std::memory_order_release);
+  }
+
+  /// Pop an element from the bottom, must be called by the owner
+  bool pop(T& value)
+  {
+    auto const b = _bottom.load(std::memory_order_relaxed) - 1;
+    auto const a = _buffer.load(std::memory_order_relaxed);
+    _bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = _top.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+      // empty
+      _bottom.store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+
+    value = a->get(b);
+    if (t == b)
+    {
+      // last element, race against thieves
+      auto const won = _top.compare_exchange_strong(
+          t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+      _bottom.store(b + 1, std::memory_order_relaxed);
+      return won;
+    }
+    return true;
+  }
+
+  /// Steal an element from the top, can be called from any thread
+  bool steal(T& value)
+  {
+    auto t = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto const b = _bottom.load(std::memory_order_acquire);
+
+    if (t >= b)
+      return false;
+
+    auto const a = _buffer.load(std::memory_order_acquire);
+    value = a->get(t);
+    return _top.compare_exchange_strong(
+        t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+  }
+
+  /// Approximate number of elements, can be called from any thread
+  std::size_t size() const
+  {
+    auto const b = _bottom.load(std::memory_order_relaxed);
+    auto const t = _top.load(std::memory_order_relaxed);
+    return b > t ? static_cast<std::size_t>(b - t) : 0;
+  }
+
+  bool empty() const
+  {
+    return size() == 0;
+  }
+
+private:
+  struct buffer
+  {
+    std::int64_t const capacity;
+    std::unique_ptr<std::atomic<T>[]> data;
+
+    explicit buffer(std::int64_t capacity)
+      : capacity(capacity), data(new std::atomic<T>[capacity])
+    {
+    }
+
+    T get(std::int64_t i) const
+    {
+      return data[i & (capacity - 1)].load(std::memory_order_relaxed);
+    }
+
+    void put(std::int64_t i, T value)
+    {
+      data[i & (capacity - 1)].store(value, std::memory_order_relaxed);
+    }
+  };
+
+  alignas(64) std::atomic<std::int64_t> _top{0};
+  alignas(64) std::atomic<std::int64_t> _bottom{0};
+  alignas(64) std::atomic<buffer*> _buffer;
+  // only touched by the owner
+  std::vector<std::unique_ptr<buffer>> _buffers;
+
+  buffer* grow(buffer* a, std::int64_t b, std::int64_t t)
+  {
+    auto bigger = std::make_unique<buffer>(a->capacity * 2);
+    for (auto i = t; i < b; ++i)
+      bigger->put(i, a->get(i));
+    _buffers.push_back(std::move(bigger));
+    auto const ret = _buffers.back().get();
+    _buffer.store(ret, std::memory_order_release);
+    return ret;
+  }
+};
+}
+}
+
+#endif
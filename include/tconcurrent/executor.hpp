@@ -3,21 +3,121 @@
 
 #include <tconcurrent/detail/boost_fwd.hpp>
 #include <tconcurrent/detail/export.hpp>
+#include <tconcurrent/task_name.hpp>
+#include <tconcurrent/task_priority.hpp>
 
 #include <function2/function2.hpp>
 
 #include <memory>
-#include <string>
+#include <type_traits>
+#include <vector>
 
 namespace tconcurrent
 {
+namespace detail
+{
+template <typename T, typename = void>
+struct has_post_bulk : std::false_type
+{
+};
+
+template <typename T>
+struct has_post_bulk<
+    T,
+    std::void_t<decltype(std::declval<T&>().post_bulk(
+        std::declval<std::vector<fu2::unique_function<void()>>>(),
+        std::declval<task_name>()))>> : std::true_type
+{
+};
+
+template <typename T, typename = void>
+struct has_prioritized_post : std::false_type
+{
+};
+
+template <typename T>
+struct has_prioritized_post<
+    T,
+    std::void_t<decltype(std::declval<T&>().post(
+        std::declval<fu2::unique_function<void()>>(),
+        std::declval<task_priority>(),
+        std::declval<task_name>()))>> : std::true_type
+{
+};
+}
+
+/** Whether T models the executor concept
+ *
+ * An executor has a `post(fu2::unique_function<void()>, task_name)` member.
+ * Execution contexts, that can be wrapped in an executor, also have the
+ * get_io_service(), is_single_threaded(), is_in_this_context(),
+ * signal_error(), stop_before_fork() and resume_after_fork() members.
+ */
+template <typename T, typename = void>
+struct is_executor : std::false_type
+{
+};
+
+template <typename T>
+struct is_executor<T,
+                   std::void_t<decltype(std::declval<T&>().post(
+                       std::declval<fu2::unique_function<void()>>(),
+                       std::declval<task_name>()))>> : std::true_type
+{
+};
+
+template <typename T>
+constexpr bool is_executor_v = is_executor<T>::value;
+
+namespace detail
+{
+/// Executor that posts to a non-copyable execution context, e.g. thread_pool
+template <typename T>
+class context_ref
+{
+public:
+  context_ref(T& context) : _context(&context)
+  {
+  }
+
+  template <typename... Args>
+  void post(Args&&... args)
+  {
+    _context->post(std::forward<Args>(args)...);
+  }
+
+private:
+  T* _context;
+};
+
+/** How continuations keep the executor they are given
+ *
+ * Executors are copied, except for execution contexts given by reference that
+ * can not be, they are kept by pointer and their post() is still called
+ * directly.
+ */
+template <typename E>
+using stored_executor_t =
+    std::conditional_t<std::is_lvalue_reference<E>::value &&
+                           !std::is_copy_constructible<std::decay_t<E>>::value,
+                       context_ref<std::remove_reference_t<E>>,
+                       std::decay_t<E>>;
+}
+
+/** Type-erased reference to an execution context
+ *
+ * This is a pointer to the context and a pointer to a static table of
+ * functions, it is cheap to copy and never allocates. It does not own the
+ * context, which must outlive it.
+ */
 class executor
 {
 public:
   executor() = default;
   template <typename T,
             typename = std::enable_if_t<!std::is_same<T, executor>::value>>
-  executor(T& e) : _p(std::make_shared<impl<std::decay_t<T>>>(e))
+  executor(T& e)
+    : _context(std::addressof(e)), _vtable(&model<std::decay_t<T>>::table)
   {
   }
 
@@ -26,109 +126,251 @@ public:
   executor& operator=(executor const&) = default;
   executor& operator=(executor&&) = default;
 
-  void post(fu2::unique_function<void()> work, std::string name = {})
+  void post(fu2::unique_function<void()> work, task_name name = {})
   {
-    _p->post(std::move(work), std::move(name));
+    _vtable->post(_context, std::move(work), name);
+  }
+
+  /** Post a task with the given priority
+   *
+   * Execution contexts that do not support priorities get a plain post().
+   */
+  void post(fu2::unique_function<void()> work,
+            task_priority priority,
+            task_name name = {})
+  {
+    _vtable->post_prioritized(_context, std::move(work), priority, name);
+  }
+
+  /** Post several tasks at once
+   *
+   * Execution contexts that have no post_bulk() get one post() per task.
+   */
+  void post_bulk(std::vector<fu2::unique_function<void()>> works,
+                 task_name name = {})
+  {
+    _vtable->post_bulk(_context, std::move(works), name);
   }
 
   boost::asio::io_context& get_io_service()
   {
-    return _p->get_io_service();
+    return _vtable->get_io_service(_context);
   }
 
   bool is_single_threaded() const
   {
-    return _p->is_single_threaded();
+    return _vtable->is_single_threaded(_context);
   }
 
   bool is_in_this_context() const
   {
-    return _p->is_in_this_context();
+    return _vtable->is_in_this_context(_context);
   }
 
   void signal_error(std::exception_ptr const& e)
   {
-    return _p->signal_error(e);
+    return _vtable->signal_error(_context, e);
   }
 
   void stop_before_fork()
   {
-    return _p->stop_before_fork();
+    return _vtable->stop_before_fork(_context);
   }
 
   void resume_after_fork()
   {
-    return _p->resume_after_fork();
+    return _vtable->resume_after_fork(_context);
   }
 
   explicit operator bool() const
   {
-    return !!_p;
+    return _context != nullptr;
   }
 
 private:
-  struct impl_base
-  {
-    virtual ~impl_base() = default;
-    virtual void post(fu2::unique_function<void()>, std::string) = 0;
-    virtual boost::asio::io_context& get_io_service() = 0;
-    virtual bool is_single_threaded() const = 0;
-    virtual bool is_in_this_context() const = 0;
-    virtual void signal_error(std::exception_ptr const& e) = 0;
-    virtual void stop_before_fork() = 0;
-    virtual void resume_after_fork() = 0;
+  struct vtable
+  {
+    void (*post)(void*, fu2::unique_function<void()>, task_name);
+    void (*post_prioritized)(void*,
+                             fu2::unique_function<void()>,
+                             task_priority,
+                             task_name);
+    void (*post_bulk)(void*,
+                      std::vector<fu2::unique_function<void()>>,
+                      task_name);
+    boost::asio::io_context& (*get_io_service)(void*);
+    bool (*is_single_threaded)(void const*);
+    bool (*is_in_this_context)(void const*);
+    void (*signal_error)(void*, std::exception_ptr const&);
+    void (*stop_before_fork)(void*);
+    void (*resume_after_fork)(void*);
   };
 
   template <typename T>
-  class impl : public impl_base
+  struct model
   {
-  public:
-    impl(T& context) : _context(context)
+    static T& get(void* context)
     {
+      return *static_cast<T*>(context);
     }
 
-    void post(fu2::unique_function<void()> f, std::string name) override
+    static T const& get(void const* context)
     {
-      _context.post(std::move(f), std::move(name));
+      return *static_cast<T const*>(context);
     }
 
-    boost::asio::io_context& get_io_service() override
+    static void post(void* context,
+                     fu2::unique_function<void()> f,
+                     task_name name)
     {
-      return _context.get_io_service();
+      get(context).post(std::move(f), name);
     }
 
-    bool is_single_threaded() const override
+    static void post_prioritized(void* context,
+                                 fu2::unique_function<void()> f,
+                                 task_priority priority,
+                                 task_name name)
     {
-      return _context.is_single_threaded();
+      if constexpr (detail::has_prioritized_post<T>::value)
+        get(context).post(std::move(f), priority, name);
+      else
+        get(context).post(std::move(f), name);
     }
 
-    bool is_in_this_context() const override
+    static void post_bulk(void* context,
+                          std::vector<fu2::unique_function<void()>> works,
+                          task_name name)
     {
-      return _context.is_in_this_context();
+      if constexpr (detail::has_post_bulk<T>::value)
+        get(context).post_bulk(std::move(works), name);
+      else
+        for (auto& work : works)
+          get(context).post(std::move(work), name);
     }
 
-    void signal_error(std::exception_ptr const& e) override
+    static boost::asio::io_context& get_io_service(void* context)
     {
-      return _context.signal_error(e);
+      return get(context).get_io_service();
     }
 
-    void stop_before_fork() override
+    static bool is_single_threaded(void const* context)
     {
-      return _context.stop_before_fork();
+      return get(context).is_single_threaded();
     }
 
-    void resume_after_fork() override
+    static bool is_in_this_context(void const* context)
     {
-      return _context.resume_after_fork();
+      return get(context).is_in_this_context();
     }
 
-  private:
-    T& _context;
+    static void signal_error(void* context, std::exception_ptr const& e)
+    {
+      get(context).signal_error(e);
+    }
+
+    static void stop_before_fork(void* context)
+    {
+      get(context).stop_before_fork();
+    }
+
+    static void resume_after_fork(void* context)
+    {
+      get(context).resume_after_fork();
+    }
+
+    static constexpr vtable table{&post,
+                                  &post_prioritized,
+                                  &post_bulk,
+                                  &get_io_service,
+                                  &is_single_threaded,
+                                  &is_in_this_context,
+                                  &signal_error,
+                                  &stop_before_fork,
+                                  &resume_after_fork};
   };
 
-  std::shared_ptr<impl_base> _p;
+  void* _context{nullptr};
+  vtable const* _vtable{nullptr};
 };
 
+namespace detail
+{
+/** How prioritized_executor keeps the executor it adapts
+ *
+ * Temporaries, like an inline_executor built in the call, are moved in.
+ * Anything given by reference is referred to through an executor, which
+ * ignores priorities for the contexts that have none.
+ */
+template <typename E>
+using prioritized_stored_executor_t =
+    std::conditional_t<std::is_lvalue_reference<E>::value,
+                       executor,
+                       std::decay_t<E>>;
+}
+
+/** Executor adaptor that posts all its work with the same priority
+ *
+ * This is what then() and async() use when they are given a priority.
+ * Executors that do not support priorities ignore it. A temporary executor is
+ * moved in, one given by reference must outlive the adaptor.
+ */
+template <typename E = executor>
+class prioritized_executor
+{
+public:
+  template <typename F>
+  prioritized_executor(F&& e, task_priority priority)
+    : _executor(std::forward<F>(e)), _priority(priority)
+  {
+  }
+
+  void post(fu2::unique_function<void()> work, task_name name = {})
+  {
+    if constexpr (detail::has_prioritized_post<E>::value)
+      _executor.post(std::move(work), _priority, name);
+    else
+      _executor.post(std::move(work), name);
+  }
+
+  boost::asio::io_context& get_io_service()
+  {
+    return _executor.get_io_service();
+  }
+
+  bool is_single_threaded() const
+  {
+    return _executor.is_single_threaded();
+  }
+
+  bool is_in_this_context() const
+  {
+    return _executor.is_in_this_context();
+  }
+
+  void signal_error(std::exception_ptr const& e)
+  {
+    _executor.signal_error(e);
+  }
+
+  void stop_before_fork()
+  {
+    _executor.stop_before_fork();
+  }
+
+  void resume_after_fork()
+  {
+    _executor.resume_after_fork();
+  }
+
+private:
+  E _executor;
+  task_priority _priority;
+};
+
+template <typename E>
+prioritized_executor(E&&, task_priority)
+    -> prioritized_executor<detail::prioritized_stored_executor_t<E>>;
+
 class thread_pool;
 TCONCURRENT_EXPORT executor get_default_executor();
 TCONCURRENT_EXPORT executor get_background_executor();
@@ -138,7 +380,7 @@ class synchronous_executor
 {
 public:
   template <typename F>
-  void post(F&& work, std::string const& = {})
+  void post(F&& work, task_name = {})
   {
     work();
   }
@@ -29,9 +29,19 @@ auto package(F&& f, cancelation_token_ptr token)
 namespace detail
 {
 
+/// Tag for packaged functions that take the shared state they will fulfill
+struct shared_state_callback_tag
+{
+};
+
 template <typename S, typename F>
 auto package(F&& f, cancelation_token_ptr token, bool cancelable)
     -> std::pair<packaged_task<S>, future<detail::result_of_t_<S>>>;
+template <typename S, typename F>
+auto package(shared_state_callback_tag,
+             F&& f,
+             std::weak_ptr<token_source> parent)
+    -> std::pair<packaged_task<S>, future<detail::result_of_t_<S>>>;
 }
 
 template <typename T>
@@ -99,16 +109,17 @@ public:
   auto then(E&& e, Func&& func) -> future<
       std::decay_t<decltype(std::declval<Func&&>()(std::declval<this_type>()))>>
   {
-    return then_impl(std::forward<E>(e),
-                     [p = _p,
-                      token = _cancelation_token,
-                      chain_name = _chain_name,
-                      func = std::forward<Func>(func)]() mutable {
-                       this_type fut(p);
-                       fut._cancelation_token = token;
-                       fut._chain_name = chain_name;
-                       return func(std::move(fut));
-                     });
+    using result_type =
+        std::decay_t<decltype(std::declval<Func&&>()(std::declval<this_type>()))>;
+
+    return then_impl<result_type>(
+        std::forward<E>(e),
+        [p = _p, chain_name = _chain_name, func = std::forward<Func>(func)](
+            continuation_state<result_type>&) mutable {
+          this_type fut(p);
+          fut._chain_name = chain_name;
+          return func(std::move(fut));
+        });
   }
 
   template <typename E, typename Func>
@@ -116,16 +127,27 @@ public:
       -> future<std::decay_t<decltype(std::declval<Func&&>()(
           std::declval<cancelation_token&>(), std::declval<this_type>()))>>
   {
-    return then_impl(std::forward<E>(e),
-                     [p = _p,
-                      token = _cancelation_token,
-                      chain_name = _chain_name,
-                      func = std::forward<Func>(func)]() mutable {
-                       this_type fut(p);
-                       fut._cancelation_token = token;
-                       fut._chain_name = chain_name;
-                       return func(*token, std::move(fut));
-                     });
+    using result_type = std::decay_t<decltype(std::declval<Func&&>()(
+        std::declval<cancelation_token&>(), std::declval<this_type>()))>;
+
+    return then_impl<result_type>(
+        std::forward<E>(e),
+        [p = _p, chain_name = _chain_name, func = std::forward<Func>(func)](
+            continuation_state<result_type>& state) mutable {
+          this_type fut(p);
+          fut._chain_name = chain_name;
+          return func(*state.get_task_cancelation_token(), std::move(fut));
+        });
+  }
+
+  /** Same as then(E&& e, Func&& func), the callback is posted with the given
+   * priority
+   */
+  template <typename E, typename Func>
+  auto then(E&& e, task_priority priority, Func&& func)
+  {
+    return then(prioritized_executor(std::forward<E>(e), priority),
+                std::forward<Func>(func));
   }
 
   template <typename Func>
@@ -159,14 +181,17 @@ public:
   auto and_then(E&& e, Func&& func) -> future<
       std::decay_t<decltype(std::declval<Func&&>()(std::declval<get_type>()))>>
   {
-    return then_impl(std::forward<E>(e),
-                     [p = _p,
-                      token = _cancelation_token,
-                      func = std::forward<Func>(func)]() mutable {
-                       return do_and_then_callback(*p, token.get(), [&] {
-                         return func(p->template get<get_type>());
-                       });
-                     });
+    using result_type =
+        std::decay_t<decltype(std::declval<Func&&>()(std::declval<get_type>()))>;
+
+    return then_impl<result_type>(
+        std::forward<E>(e),
+        [p = _p, func = std::forward<Func>(func)](
+            continuation_state<result_type>& state) mutable {
+          return do_and_then_callback(*p, state, [&] {
+            return func(p->template get<get_type>());
+          });
+        });
   }
   template <typename E, typename Func>
   auto and_then(E&& e, Func&& func)
@@ -174,14 +199,28 @@ public:
           std::declval<cancelation_token&>(), std::declval<get_type>()))>>
 
   {
-    return then_impl(std::forward<E>(e),
-                     [p = _p,
-                      token = _cancelation_token,
-                      func = std::forward<Func>(func)]() mutable {
-                       return do_and_then_callback(*p, token.get(), [&] {
-                         return func(*token, p->template get<get_type>());
-                       });
-                     });
+    using result_type = std::decay_t<decltype(std::declval<Func&&>()(
+        std::declval<cancelation_token&>(), std::declval<get_type>()))>;
+
+    return then_impl<result_type>(
+        std::forward<E>(e),
+        [p = _p, func = std::forward<Func>(func)](
+            continuation_state<result_type>& state) mutable {
+          return do_and_then_callback(*p, state, [&] {
+            return func(*state.get_task_cancelation_token(),
+                        p->template get<get_type>());
+          });
+        });
+  }
+
+  /** Same as and_then(E&& e, Func&& func), the callback is posted with the
+   * given priority
+   */
+  template <typename E, typename Func>
+  auto and_then(E&& e, task_priority priority, Func&& func)
+  {
+    return and_then(prioritized_executor(std::forward<E>(e), priority),
+                    std::forward<Func>(func));
   }
 
   /// Get a future equivalent to this one but discarding the result value
@@ -200,7 +239,7 @@ public:
    */
   this_type break_cancelation_chain() &&
   {
-    _cancelation_token = _p->reset_cancelation_token();
+    _p->reset_cancelation_token();
     return std::move(*this_());
   }
 
@@ -249,15 +288,15 @@ public:
   /// Return true if the future has a result value or an exception
   bool is_ready() const noexcept
   {
-    return _p && _p->_r.index() != 0;
+    return _p && _p->is_ready();
   }
   bool has_value() const noexcept
   {
-    return _p && _p->_r.index() == 1;
+    return _p && _p->is_ready() && _p->_r.index() == 1;
   }
   bool has_exception() const noexcept
   {
-    return _p && _p->_r.index() == 2;
+    return _p && _p->is_ready() && _p->_r.index() == 2;
   }
   /// Return false if the future has been default constructed or moved-from
   bool is_valid() const noexcept
@@ -285,26 +324,33 @@ public:
     return _p->get_exception();
   }
 
-  std::string const& get_chain_name() const
+  /** Get the name that will be propagated to then and and_then
+   *
+   * It refers to the string given to update_chain_name(), the future does not
+   * keep a copy of it.
+   */
+  std::string_view get_chain_name() const
   {
     return _chain_name;
   }
 
   /** Return a new future with a different name that will be propagated to then
    * and and_then
+   *
+   * The name must outlive the chain, see task_name.
    */
-  this_type update_chain_name(std::string name) &&
+  this_type update_chain_name(task_name name) &&
   {
     this_type ret{std::move(*this_())};
-    ret._chain_name = std::move(name);
+    ret._chain_name = name.name();
     return ret;
   }
 
   /** Update the name that will be propagated to then and and_then
    */
-  this_type& update_chain_name(std::string name) &
+  this_type& update_chain_name(task_name name) &
   {
-    _chain_name = std::move(name);
+    _chain_name = name.name();
     return *this;
   }
 
@@ -313,11 +359,8 @@ protected:
   using shared_pointer = std::shared_ptr<shared_type>;
 
   shared_pointer _p;
-  // the cancelation_token in _p will be lost when the promise is set, keep a
-  // copy here so that continuations can still use it
-  cancelation_token_ptr _cancelation_token;
 
-  std::string _chain_name;
+  std::string_view _chain_name;
 
   future_base() = default;
   future_base(future_base const&) = default;
@@ -326,17 +369,12 @@ protected:
   future_base& operator=(future_base&&) = default;
   ~future_base() = default;
 
-  future_base(shared_pointer p)
-    : _p(std::move(p)), _cancelation_token(_p->get_cancelation_token())
+  future_base(shared_pointer p) : _p(std::move(p))
   {
   }
 
-  future_base(shared_pointer p,
-              cancelation_token_ptr cancelation_token,
-              std::string chain_name)
-    : _p(std::move(p))
-    , _cancelation_token(std::move(cancelation_token))
-    , _chain_name(std::move(chain_name))
+  future_base(shared_pointer p, std::string_view chain_name)
+    : _p(std::move(p)), _chain_name(chain_name)
   {
   }
 
@@ -346,30 +384,31 @@ private:
     return static_cast<this_type*>(this);
   }
 
-  template <typename E, typename Func>
-  auto then_impl(E&& e, Func&& func)
-      -> future<typename std::decay<decltype(func())>::type>
-  {
-    using result_type = typename std::decay<decltype(func())>::type;
+  /// The shared state of a continuation returning a U
+  template <typename U>
+  using continuation_state = detail::shared_base<detail::void_to_tvoid_t<U>>;
 
-    auto pack =
-        package<result_type()>(std::forward<Func>(func), _cancelation_token);
-    _p->then(_chain_name + " (" + typeid(Func).name() + ")",
+  template <typename U, typename E, typename Func>
+  auto then_impl(E&& e, Func&& func) -> future<U>
+  {
+    // the continuation gets our token only if someone asks for one while we
+    // are pending, so that cancelation requests on it reach us
+    auto pack = detail::package<U()>(
+        detail::shared_state_callback_tag{}, std::forward<Func>(func), _p);
+    _p->then(task_name(_chain_name, &typeid(Func)),
              std::forward<E>(e),
              std::move(pack.first));
     pack.second._chain_name = _chain_name;
     return std::move(pack.second);
   }
 
-  template <typename Func>
-  static auto do_and_then_callback(shared_type& p,
-                                   cancelation_token* token,
-                                   Func&& cb)
+  template <typename S, typename Func>
+  static auto do_and_then_callback(shared_type& p, S const& state, Func&& cb)
   {
-    assert(p._r.index() != 0);
+    assert(p.is_ready());
     if (p._r.index() == 1)
     {
-      if (token && token->is_cancel_requested())
+      if (state.is_task_cancel_requested())
         throw operation_canceled();
       else
         return cb();
@@ -477,6 +516,11 @@ private:
                               cancelation_token_ptr token,
                               bool cancelable)
       -> std::pair<packaged_task<S>, future<detail::result_of_t_<S>>>;
+  template <typename S, typename F>
+  friend auto detail::package(detail::shared_state_callback_tag,
+                              F&& f,
+                              std::weak_ptr<detail::token_source> parent)
+      -> std::pair<packaged_task<S>, future<detail::result_of_t_<S>>>;
   template <typename T>
   friend class promise;
   template <typename T>
@@ -495,9 +539,7 @@ private:
 
 template <typename R>
 shared_future<R>::shared_future(future<R>&& fut)
-  : base_type(std::move(fut._p),
-              std::move(fut._cancelation_token),
-              std::move(fut._chain_name))
+  : base_type(std::move(fut._p), fut._chain_name)
 {
 }
 
@@ -514,8 +556,8 @@ template <template <typename> class Fut1,
 Fut2<R> detail::future_unwrap<Fut1<Fut2<R>>>::unwrap()
 {
   auto& fut1 = static_cast<Fut1<Fut2<R>>&>(*this);
-  auto sb = std::make_shared<typename future<R>::shared_type>(
-      fut1._cancelation_token);
+  auto sb = detail::make_pooled_shared<typename future<R>::shared_type>(
+      std::weak_ptr<detail::token_source>(fut1._p));
   fut1.then(get_synchronous_executor(), [sb](Fut1<Fut2<R>> fut1) {
     if (fut1.has_exception())
       sb->set_exception(fut1.get_exception());
@@ -523,7 +565,7 @@ Fut2<R> detail::future_unwrap<Fut1<Fut2<R>>>::unwrap()
     {
       auto fut2 = fut1.get();
       cancelation_token_ptr token;
-      if (sb->get_cancelation_token() != fut2._cancelation_token)
+      if (sb->get_cancelation_token() != fut2._p->get_cancelation_token())
       {
         token = sb->get_cancelation_token();
         token->push_cancelation_callback(fut2.make_canceler());
@@ -551,10 +593,9 @@ auto make_ready_future(T&& val) -> future<typename std::decay<T>::type>
   using result_type = typename std::decay<T>::type;
   using shared_base_type = detail::shared_base<result_type>;
 
-  auto sb = std::make_shared<shared_base_type>(detail::nocancel_tag{});
-  sb->_r = typename shared_base_type::v_value{std::forward<T>(val)};
+  auto sb = detail::make_pooled_shared<shared_base_type>();
+  sb->set(std::forward<T>(val));
   future<result_type> fut(std::move(sb));
-  fut._cancelation_token = std::make_shared<cancelation_token>();
   return fut;
 }
 
@@ -563,10 +604,9 @@ inline auto make_ready_future() -> future<void>
 {
   using shared_base_type = future<void>::shared_type;
 
-  auto sb = std::make_shared<shared_base_type>(detail::nocancel_tag{});
-  sb->_r = shared_base_type::v_value{};
+  auto sb = detail::make_pooled_shared<shared_base_type>();
+  sb->set({});
   future<void> fut(std::move(sb));
-  fut._cancelation_token = std::make_shared<cancelation_token>();
   return fut;
 }
 
@@ -577,11 +617,9 @@ auto make_exceptional_future(E&& err) -> future<T>
   using result_type = typename future<T>::value_type;
   using shared_base_type = detail::shared_base<result_type>;
 
-  auto sb = std::make_shared<shared_base_type>(detail::nocancel_tag{});
-  sb->_r = typename shared_base_type::v_exception{
-      std::make_exception_ptr(std::forward<E>(err))};
+  auto sb = detail::make_pooled_shared<shared_base_type>();
+  sb->set_exception(std::make_exception_ptr(std::forward<E>(err)));
   future<T> fut(std::move(sb));
-  fut._cancelation_token = std::make_shared<cancelation_token>();
   return fut;
 }
 
@@ -0,0 +1,106 @@
+#ifndef TCONCURRENT_INLINE_EXECUTOR_HPP
+#define TCONCURRENT_INLINE_EXECUTOR_HPP
+
+#include <tconcurrent/detail/export.hpp>
+#include <tconcurrent/executor.hpp>
+
+#include <function2/function2.hpp>
+
+namespace tconcurrent
+{
+namespace detail
+{
+/// Number of tasks currently nested by inline_executor on this thread
+TCONCURRENT_EXPORT unsigned& inline_execution_depth();
+}
+
+/** Executor adaptor that runs work in place when it is already in its context
+ *
+ * When work is posted from a thread that runs in the context of the adapted
+ * executor, it is run immediately instead of going through the executor's
+ * queue. This saves a round trip per continuation in long chains, e.g.:
+ *
+ *     fut.and_then(inline_executor(get_default_executor()), f1)
+ *         .and_then(inline_executor(get_default_executor()), f2);
+ *
+ * To avoid stack overflows, at most max_depth tasks are nested this way on a
+ * thread, the next ones are posted as usual.
+ *
+ * Work that runs in place runs before post() returns, the caller must not hold
+ * a lock that the work may need.
+ */
+class inline_executor
+{
+public:
+  static constexpr unsigned default_max_depth = 16;
+
+  inline_executor(executor e, unsigned max_depth = default_max_depth)
+    : _executor(std::move(e)), _max_depth(max_depth)
+  {
+  }
+
+  void post(fu2::unique_function<void()> work, task_name name = {})
+  {
+    auto& depth = detail::inline_execution_depth();
+    if (depth >= _max_depth || !_executor.is_in_this_context())
+    {
+      _executor.post(std::move(work), name);
+      return;
+    }
+
+    struct depth_guard
+    {
+      unsigned& depth;
+      ~depth_guard()
+      {
+        --depth;
+      }
+    } guard{++depth};
+
+    try
+    {
+      work();
+    }
+    catch (...)
+    {
+      _executor.signal_error(std::current_exception());
+    }
+  }
+
+  boost::asio::io_context& get_io_service()
+  {
+    return _executor.get_io_service();
+  }
+
+  bool is_single_threaded() const
+  {
+    return _executor.is_single_threaded();
+  }
+
+  bool is_in_this_context() const
+  {
+    return _executor.is_in_this_context();
+  }
+
+  void signal_error(std::exception_ptr const& e)
+  {
+    _executor.signal_error(e);
+  }
+
+  void stop_before_fork()
+  {
+    _executor.stop_before_fork();
+  }
+
+  void resume_after_fork()
+  {
+    _executor.resume_after_fork();
+  }
+
+private:
+  executor _executor;
+  unsigned _max_depth;
+};
+}
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef TCONCURRENT_LATENCY_HISTOGRAM_HPP
+#define TCONCURRENT_LATENCY_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace tconcurrent
+{
+namespace detail
+{
+class atomic_latency_histogram;
+}
+
+/** Histogram of durations with a bounded relative error
+ *
+ * Durations are counted in nanoseconds in log-linear buckets, like HDR
+ * histograms do: each power of two is split in 2^sub_bucket_bits buckets of
+ * equal width, so a bucket is never wider than 1/8th of its lower bound. The
+ * first buckets hold one value each.
+ */
+class latency_histogram
+{
+public:
+  using duration = std::chrono::nanoseconds;
+  using rep = duration::rep;
+
+  static constexpr unsigned sub_bucket_bits = 3;
+  static constexpr std::size_t sub_bucket_count = std::size_t(1)
+                                                  << sub_bucket_bits;
+  // durations are signed, their most significant bit is at most the 62nd
+  static constexpr std::size_t bucket_count =
+      (63 - sub_bucket_bits + 1) * sub_bucket_count;
+
+  static std::size_t bucket_index(duration d)
+  {
+    auto const v = static_cast<std::uint64_t>(std::max(d.count(), rep(0)));
+    if (v < sub_bucket_count)
+      return static_cast<std::size_t>(v);
+    auto const shift = most_significant_bit(v) - sub_bucket_bits;
+    auto const sub = (v >> shift) & (sub_bucket_count - 1);
+    return (shift + 1) * sub_bucket_count + static_cast<std::size_t>(sub);
+  }
+
+  /// Smallest duration counted in bucket \p index
+  static duration bucket_lower_bound(std::size_t index)
+  {
+    if (index < sub_bucket_count)
+      return duration(static_cast<rep>(index));
+    auto const shift = index / sub_bucket_count - 1;
+    auto const sub = index % sub_bucket_count;
+    return duration(static_cast<rep>((sub_bucket_count + sub) << shift));
+  }
+
+  /// Largest duration counted in bucket \p index
+  static duration bucket_upper_bound(std::size_t index)
+  {
+    if (index < sub_bucket_count)
+      return duration(static_cast<rep>(index));
+    auto const shift = index / sub_bucket_count - 1;
+    return bucket_lower_bound(index) +
+           duration((static_cast<rep>(1) << shift) - 1);
+  }
+
+  void record(duration d, std::uint64_t n = 1)
+  {
+    _buckets[bucket_index(d)] += n;
+    _count += n;
+    _sum += d * static_cast<rep>(n);
+    _max = std::max(_max, d);
+  }
+
+  void merge(latency_histogram const& other)
+  {
+    for (std::size_t i = 0; i < bucket_count; ++i)
+      _buckets[i] += other._buckets[i];
+    _count += other._count;
+    _sum += other._sum;
+    _max = std::max(_max, other._max);
+  }
+
+  std::uint64_t count() const
+  {
+    return _count;
+  }
+
+  duration max() const
+  {
+    return _max;
+  }
+
+  duration mean() const
+  {
+    return _count ? _sum / static_cast<rep>(_count) : duration::zero();
+  }
+
+  /** Get the duration under which \p ratio of the recorded durations are
+   *
+   * \p ratio is in [0, 1], e.g. 0.99 for the 99th percentile. The result is
+   * the upper bound of the bucket it falls in, and never more than max().
+   */
+  duration percentile(double ratio) const
+  {
+    if (!_count)
+      return duration::zero();
+    auto const rank = std::max<std::uint64_t>(
+        1, static_cast<std::uint64_t>(ratio * static_cast<double>(_count)));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < bucket_count; ++i)
+    {
+      seen += _buckets[i];
+      if (seen >= rank)
+        return std::min(bucket_upper_bound(i), _max);
+    }
+    return _max;
+  }
+
+  std::array<std::uint64_t, bucket_count> const& buckets() const
+  {
+    return _buckets;
+  }
+
+private:
+  friend class detail::atomic_latency_histogram;
+
+  static unsigned most_significant_bit(std::uint64_t v)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - static_cast<unsigned>(__builtin_clzll(v));
+#else
+    unsigned msb = 0;
+    while (v >>= 1)
+      ++msb;
+    return msb;
+#endif
+  }
+
+  std::array<std::uint64_t, bucket_count> _buckets{};
+  std::uint64_t _count{0};
+  duration _sum{0};
+  duration _max{0};
+};
+
+namespace detail
+{
+/// latency_histogram that can be recorded to concurrently
+class atomic_latency_histogram
+{
+public:
+  void record(latency_histogram::duration d)
+  {
+    _buckets[latency_histogram::bucket_index(d)].fetch_add(
+        1, std::memory_order_relaxed);
+    auto const ns = static_cast<std::uint64_t>(std::max(d.count(), rep(0)));
+    _sum.fetch_add(ns, std::memory_order_relaxed);
+    auto max = _max.load(std::memory_order_relaxed);
+    while (ns > max &&
+           !_max.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+      ;
+  }
+
+  /// Add what was recorded so far to \p h
+  void snapshot_into(latency_histogram& h) const
+  {
+    // the fields are read one by one, they may be slightly inconsistent if
+    // durations are recorded meanwhile
+    for (std::size_t i = 0; i < latency_histogram::bucket_count; ++i)
+    {
+      auto const n = _buckets[i].load(std::memory_order_relaxed);
+      h._buckets[i] += n;
+      h._count += n;
+    }
+    h._sum += latency_histogram::duration(
+        static_cast<rep>(_sum.load(std::memory_order_relaxed)));
+    h._max = std::max(h._max,
+                      latency_histogram::duration(static_cast<rep>(
+                          _max.load(std::memory_order_relaxed))));
+  }
+
+private:
+  using rep = latency_histogram::duration::rep;
+
+  std::array<std::atomic<std::uint64_t>, latency_histogram::bucket_count>
+      _buckets{};
+  std::atomic<std::uint64_t> _sum{0};
+  std::atomic<std::uint64_t> _max{0};
+};
+}
+}
+
+#endif
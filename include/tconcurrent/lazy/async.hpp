@@ -3,7 +3,8 @@
 
 #include <atomic>
 #include <memory>
-#include <string>
+
+#include <tconcurrent/task_name.hpp>
 
 namespace tconcurrent
 {
@@ -29,7 +30,7 @@ struct async_sender
   using value_types = Tuple<>;
 
   E executor;
-  std::string name;
+  task_name name;
 
   template <typename R>
   void submit(R&& receiver)
@@ -47,7 +48,7 @@ struct async_sender
             return;
           data->receiver.set_value();
         },
-        std::move(name));
+        name);
   };
 };
 }
@@ -55,10 +56,10 @@ struct async_sender
 /** Make a sender that will call its receiver on \p executor.
  */
 template <typename E>
-auto async(E&& executor, std::string name = {})
+auto async(E&& executor, task_name name = {})
 {
   return detail::async_sender<std::decay_t<E>>{std::forward<E>(executor),
-                                               std::move(name)};
+                                               name};
 }
 }
 }
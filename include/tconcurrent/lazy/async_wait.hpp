@@ -3,12 +3,10 @@
 
 #include <tconcurrent/lazy/cancelation_token.hpp>
 
+#include <tconcurrent/detail/node_pool.hpp>
+#include <tconcurrent/detail/timer_wheel.hpp>
 #include <tconcurrent/executor.hpp>
 
-#include <boost/asio/io_context.hpp>
-#include <boost/asio/steady_timer.hpp>
-
-#include <atomic>
 #include <chrono>
 
 namespace tconcurrent
@@ -18,47 +16,42 @@ namespace lazy
 namespace detail
 {
 template <typename Receiver>
-struct async_wait_data
+struct async_wait_timer final : ::tconcurrent::detail::timer_node
 {
-  boost::asio::steady_timer timer;
   Receiver receiver;
-  std::atomic<bool> fired{false};
 
-  template <typename Delay, typename ReceiverArg>
-  async_wait_data(boost::asio::io_context& io,
-                  Delay delay,
-                  ReceiverArg&& receiver)
-    : timer(io, delay), receiver(std::forward<ReceiverArg>(receiver))
+  template <typename ReceiverArg>
+  explicit async_wait_timer(ReceiverArg&& receiver)
+    : receiver(std::forward<ReceiverArg>(receiver))
+  {
+  }
+
+  void fire() override
   {
+    receiver.set_value();
   }
 };
 
 struct async_wait_sender
 {
-  boost::asio::io_context* io_context;
+  ::tconcurrent::detail::timer_wheel* wheel;
   std::chrono::steady_clock::duration delay;
+  std::chrono::steady_clock::duration slack;
 
   template <typename R>
   void submit(R&& receiver)
   {
-    auto const data = std::make_shared<
-        detail::async_wait_data<std::decay_t<decltype(receiver)>>>(
-        *io_context, delay, std::forward<decltype(receiver)>(receiver));
-
-    data->timer.async_wait([data](boost::system::error_code const&) mutable {
-      if (data->fired.exchange(true))
-        return;
-
-      data->receiver.set_value();
-    });
+    auto const timer = ::tconcurrent::detail::make_pooled_shared<
+        detail::async_wait_timer<std::decay_t<decltype(receiver)>>>(
+        std::forward<decltype(receiver)>(receiver));
 
-    data->receiver.get_cancelation_token()->set_canceler([data] {
-      if (data->fired.exchange(true))
-        return;
+    wheel->arm(timer, std::chrono::steady_clock::now() + delay, slack);
 
-      data->timer.cancel();
-      data->receiver.set_done();
-    });
+    timer->receiver.get_cancelation_token()->set_canceler(
+        [wheel = wheel, timer] {
+          if (wheel->cancel(*timer))
+            timer->receiver.set_done();
+        });
   }
 
   template <template <typename...> class Tuple>
@@ -67,10 +60,18 @@ struct async_wait_sender
 }
 
 /** Make a sender that calls its receiver on \p executor after \p delay.
+ *
+ * The receiver may be called up to \p slack later, see tc::async_wait().
  */
-auto async_wait(executor executor, std::chrono::steady_clock::duration delay)
+inline auto async_wait(executor executor,
+                       std::chrono::steady_clock::duration delay,
+                       std::chrono::steady_clock::duration slack =
+                           std::chrono::steady_clock::duration::zero())
 {
-  return detail::async_wait_sender{&executor.get_io_service(), delay};
+  return detail::async_wait_sender{
+      &::tconcurrent::detail::timer_wheel::get(executor.get_io_service()),
+      delay,
+      slack};
 }
 }
 }
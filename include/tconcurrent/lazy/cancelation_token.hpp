@@ -59,8 +59,12 @@ public:
     lock_guard l(_mutex);
     assert(!_cancel);
     _cancel = std::move(canceler);
+    // same as in request_cancel(), the canceler may reset this token
     if (_canceled)
-      _cancel();
+    {
+      auto canceler = _cancel;
+      canceler();
+    }
   }
   void reset()
   {
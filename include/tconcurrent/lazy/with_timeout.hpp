@@ -0,0 +1,127 @@
+#ifndef TCONCURRENT_LAZY_WITH_TIMEOUT_HPP
+#define TCONCURRENT_LAZY_WITH_TIMEOUT_HPP
+
+#include <tconcurrent/lazy/cancelation_token.hpp>
+
+#include <tconcurrent/detail/node_pool.hpp>
+#include <tconcurrent/detail/timer_wheel.hpp>
+#include <tconcurrent/executor.hpp>
+#include <tconcurrent/timed_out.hpp>
+
+#include <chrono>
+#include <exception>
+#include <memory>
+
+namespace tconcurrent
+{
+namespace lazy
+{
+namespace detail
+{
+// The timer holds the receiver and the token given to the sender, whichever
+// of the sender and the timer makes timer_wheel::cancel() fail came second
+// and does nothing.
+template <typename Receiver>
+struct timeout_timer final : ::tconcurrent::detail::timer_node
+{
+  ::tconcurrent::detail::timer_wheel* wheel;
+  Receiver receiver;
+  cancelation_token sender_token;
+
+  template <typename ReceiverArg>
+  timeout_timer(::tconcurrent::detail::timer_wheel& wheel,
+                ReceiverArg&& receiver)
+    : wheel(&wheel), receiver(std::forward<ReceiverArg>(receiver))
+  {
+  }
+
+  void fire() override
+  {
+    sender_token.request_cancel();
+    receiver.set_error(std::make_exception_ptr(timed_out()));
+  }
+};
+
+template <typename Receiver>
+struct timeout_receiver
+{
+  std::shared_ptr<timeout_timer<Receiver>> _timer;
+
+  auto get_cancelation_token()
+  {
+    return &_timer->sender_token;
+  }
+  template <typename... V>
+  void set_value(V&&... vs)
+  {
+    if (finish())
+      _timer->receiver.set_value(std::forward<V>(vs)...);
+  }
+  template <typename E>
+  void set_error(E&& e)
+  {
+    if (finish())
+      _timer->receiver.set_error(std::forward<E>(e));
+  }
+  void set_done()
+  {
+    if (finish())
+      _timer->receiver.set_done();
+  }
+
+private:
+  // The canceler of the sender may hold this receiver, and thus the timer
+  bool finish()
+  {
+    _timer->sender_token.reset();
+    return _timer->wheel->cancel(*_timer);
+  }
+};
+
+template <typename Sender>
+struct timeout_sender
+{
+  template <template <typename...> class Tuple>
+  using value_types = typename Sender::template value_types<Tuple>;
+
+  Sender sender;
+  ::tconcurrent::detail::timer_wheel* wheel;
+  std::chrono::steady_clock::duration timeout;
+
+  template <typename R>
+  void submit(R&& receiver)
+  {
+    auto const timer = ::tconcurrent::detail::make_pooled_shared<
+        detail::timeout_timer<std::decay_t<R>>>(*wheel,
+                                                std::forward<R>(receiver));
+
+    wheel->arm(timer, std::chrono::steady_clock::now() + timeout);
+
+    timer->receiver.get_cancelation_token()->set_canceler(
+        [timer] { timer->sender_token.request_cancel(); });
+
+    sender.submit(timeout_receiver<std::decay_t<R>>{timer});
+  }
+};
+}
+
+/** Make a sender that runs \p sender, or finishes with timed_out after \p
+ * timeout.
+ *
+ * When the timeout expires first, \p sender is canceled and its result is
+ * ignored.
+ */
+template <typename Sender>
+auto with_timeout(executor executor,
+                  Sender&& sender,
+                  std::chrono::steady_clock::duration timeout)
+{
+  return detail::timeout_sender<std::decay_t<Sender>>{
+      std::forward<Sender>(sender),
+      &::tconcurrent::detail::timer_wheel::get(executor.get_io_service()),
+      timeout};
+}
+}
+}
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef TCONCURRENT_LOCKFREE_QUEUE_HPP
+#define TCONCURRENT_LOCKFREE_QUEUE_HPP
+
+#include <tconcurrent/detail/mpmc_queue.hpp>
+#include <tconcurrent/promise.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+
+namespace tconcurrent
+{
+/** Unbounded multi-producer multi-consumer queue with a lock-free fast path
+ *
+ * It has the same interface as concurrent_queue, but items go through a
+ * lock-free ring allocated at construction, so push and pop take no lock and
+ * allocate nothing while there are items to pop and free slots in the ring.
+ * pop() still allocates the state of the ready future it returns, try_pop()
+ * does not.
+ *
+ * A mutex is only taken to park a pop on a promise when the queue is empty, to
+ * give an item to such a pop, and when the ring is full, in which case items
+ * overflow in a list until the ring is drained.
+ *
+ * Items pushed by a given thread are popped in the order they were pushed.
+ */
+template <typename T>
+class lockfree_queue
+{
+public:
+  static constexpr std::size_t default_ring_capacity = 1024;
+
+  explicit lockfree_queue(std::size_t ring_capacity = default_ring_capacity)
+    : _ring(ring_capacity)
+  {
+  }
+
+  lockfree_queue(lockfree_queue const&) = delete;
+  lockfree_queue& operator=(lockfree_queue const&) = delete;
+
+  void push(T val)
+  {
+    if (_count.fetch_add(1, std::memory_order_acq_rel) < 0)
+      return hand_off(std::move(val));
+    if (!_overflowing.load(std::memory_order_acquire) && _ring.try_push(val))
+      return;
+    overflow(std::move(val));
+  }
+
+  future<T> pop()
+  {
+    if (_count.fetch_sub(1, std::memory_order_acq_rel) > 0)
+      return make_ready_future(take());
+    return park();
+  }
+
+  /// Pop an item if there is one, never waits
+  std::optional<T> try_pop()
+  {
+    auto count = _count.load(std::memory_order_relaxed);
+    while (count > 0)
+      if (_count.compare_exchange_weak(
+              count, count - 1, std::memory_order_acq_rel))
+        return take();
+    return std::nullopt;
+  }
+
+  std::size_t size() const
+  {
+    auto const count = _count.load(std::memory_order_relaxed);
+    return count > 0 ? static_cast<std::size_t>(count) : 0;
+  }
+
+private:
+  using mutex_t = std::mutex;
+  using scope_lock = std::lock_guard<mutex_t>;
+
+  // Number of items pushed minus number of pops, it is negative when pops are
+  // waiting. Whoever changes it decides from its previous value whether there
+  // is an item to take or a pop to give an item to.
+  std::atomic<std::ptrdiff_t> _count{0};
+  detail::mpmc_queue<T> _ring;
+  std::atomic<bool> _overflowing{false};
+
+  mutable mutex_t _mutex;
+  // items that did not fit in the ring, they are popped once it is empty
+  std::deque<T> _overflow;
+  // items given to pops that did not park yet
+  std::deque<T> _handoffs;
+  std::queue<promise<T>> _waiters;
+
+  T take()
+  {
+    // the count tells there is an item, but its producer may not have stored
+    // it yet
+    while (true)
+    {
+      if (auto val = _ring.try_pop())
+        return std::move(*val);
+      if (_overflowing.load(std::memory_order_acquire))
+      {
+        scope_lock l(_mutex);
+        // an item of the same thread may still be filled in the ring
+        if (!_overflow.empty() && _ring.empty())
+        {
+          auto val = std::move(_overflow.front());
+          _overflow.pop_front();
+          if (_overflow.empty())
+            _overflowing.store(false, std::memory_order_release);
+          return val;
+        }
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  void overflow(T val)
+  {
+    scope_lock l(_mutex);
+    // items must not overtake the ones of their thread in the overflow list
+    if (_overflow.empty() && _ring.try_push(val))
+      return;
+    _overflow.push_back(std::move(val));
+    _overflowing.store(true, std::memory_order_release);
+  }
+
+  future<T> park()
+  {
+    scope_lock l(_mutex);
+    if (!_handoffs.empty())
+    {
+      auto ret = make_ready_future(std::move(_handoffs.front()));
+      _handoffs.pop_front();
+      return ret;
+    }
+    promise<T> prom;
+    _waiters.push(prom);
+    return prom.get_future();
+  }
+
+  void hand_off(T val)
+  {
+    std::optional<promise<T>> prom;
+    {
+      scope_lock l(_mutex);
+      // the pop that made the count negative may not have parked yet
+      if (_waiters.empty())
+      {
+        _handoffs.push_back(std::move(val));
+        return;
+      }
+      prom.emplace(std::move(_waiters.front()));
+      _waiters.pop();
+    }
+    prom->set_value(std::move(val));
+  }
+};
+}
+
+#endif
@@ -64,14 +64,19 @@ struct package_caller<void>
 template <typename>
 struct shared; // not defined
 
+template <typename S>
+class packaged_task_canceler;
+
 template <typename R, typename... Args>
 struct shared<R(Args...)> : shared_base<void_to_tvoid_t<R>>
 {
   using base_type = shared_base<void_to_tvoid_t<R>>;
 
   std::atomic<bool> _done{false};
-  fu2::unique_function<R(cancelation_token&, Args...)> _f;
+  task_function<R(base_type&, Args...)> _f;
   bool _cancelable;
+  /// Set when the canceler must be pushed on the token once it is created
+  std::weak_ptr<shared> _self;
 
   template <typename F>
   shared(
@@ -81,7 +86,7 @@ struct shared<R(Args...)> : shared_base<void_to_tvoid_t<R>>
       void_t<decltype(std::declval<F>()(std::declval<Args>()...))>* = nullptr)
     : base_type(std::move(token))
     , _cancelable(cancelable)
-    , _f([f = std::forward<F>(f)](cancelation_token&, auto&&... args) mutable {
+    , _f([f = std::forward<F>(f)](base_type&, auto&&... args) mutable {
       return f(std::forward<decltype(args)>(args)...);
     })
   {
@@ -96,7 +101,17 @@ struct shared<R(Args...)> : shared_base<void_to_tvoid_t<R>>
                                         std::declval<Args>()...))>** = nullptr)
     : base_type(std::move(token))
     , _cancelable(cancelable)
-    , _f(std::forward<F>(f))
+    , _f([f = std::forward<F>(f)](base_type& state, auto&&... args) mutable {
+      // only functions that take a token make us create one
+      return f(*state.get_task_cancelation_token(),
+               std::forward<decltype(args)>(args)...);
+    })
+  {
+  }
+
+  template <typename F>
+  shared(shared_state_callback_tag, std::weak_ptr<token_source> parent, F&& f)
+    : base_type(std::move(parent)), _f(std::forward<F>(f)), _cancelable(false)
   {
     assert(_f);
   }
@@ -109,9 +124,8 @@ struct shared<R(Args...)> : shared_base<void_to_tvoid_t<R>>
     try
     {
       if (_cancelable)
-        this->_cancelation_token->pop_cancelation_callback();
-      package_caller<R>::do_call(
-          *this, _f, *this->_cancelation_token, std::forward<A>(args)...);
+        this->get_cancelation_token()->pop_cancelation_callback();
+      package_caller<R>::do_call(*this, _f, *this, std::forward<A>(args)...);
     }
     catch (...)
     {
@@ -119,13 +133,22 @@ struct shared<R(Args...)> : shared_base<void_to_tvoid_t<R>>
     }
     _f = nullptr;
   }
+
+protected:
+  void on_token_created(cancelation_token& token) override
+  {
+    // once the task started, the canceler would be a no-op
+    if (!_self.expired() && !_done.load())
+      token.push_cancelation_callback(
+          packaged_task_canceler<R(Args...)>{_self, &token});
+  }
 };
 
 template <typename S>
 class packaged_task_canceler
 {
 public:
-  packaged_task_canceler(std::shared_ptr<shared<S>> p,
+  packaged_task_canceler(std::weak_ptr<shared<S>> p,
                          cancelation_token* cancelation_token)
     : _p(std::move(p)), _token(cancelation_token)
   {
@@ -136,11 +159,14 @@ public:
     // If we got the _done lock just below, the callback may die
     // asynchronously, setting the promise state to broken_promise. That's why
     // we lock the promise_ptr before that line.
-    auto const pp = promise_ptr<detail::shared<S>>::try_lock(std::move(_p));
+    auto const p = _p.lock();
+    if (!p)
+      return;
+    auto const pp = promise_ptr<detail::shared<S>>::try_lock(p);
     if (!pp)
     {
       // the promise is already dead, this means the callback has run
-      assert(_p->_done.load());
+      assert(p->_done.load());
       return;
     }
     if (pp->_done.exchange(true))
@@ -152,7 +178,8 @@ public:
   }
 
 private:
-  std::shared_ptr<shared<S>> _p;
+  // the token may outlive the state, which holds the token
+  std::weak_ptr<shared<S>> _p;
   cancelation_token* _token;
 };
 
@@ -161,10 +188,32 @@ auto package(F&& f, cancelation_token_ptr token, bool cancelable)
     -> std::pair<packaged_task<S>, future<detail::result_of_t_<S>>>
 {
   auto const p = promise_ptr<detail::shared<S>>::make_shared(
-      cancelable, token, std::forward<F>(f));
+      cancelable && token, token, std::forward<F>(f));
   if (cancelable)
-    token->push_cancelation_callback(
-        packaged_task_canceler<S>{p.as_shared(), token.get()});
+  {
+    if (token)
+      token->push_cancelation_callback(
+          packaged_task_canceler<S>{p.as_shared(), token.get()});
+    else
+      p->_self = p.as_shared();
+  }
+  return std::make_pair(packaged_task<S>(p),
+                        future<detail::result_of_t_<S>>(p.as_shared()));
+}
+
+/** Package a function that takes the shared state it will fulfill
+ *
+ * This lets continuations check for cancelation without creating a token.
+ * The state gets the token of \p parent when someone asks for one.
+ */
+template <typename S, typename F>
+auto package(shared_state_callback_tag,
+             F&& f,
+             std::weak_ptr<token_source> parent)
+    -> std::pair<packaged_task<S>, future<detail::result_of_t_<S>>>
+{
+  auto const p = promise_ptr<detail::shared<S>>::make_shared(
+      shared_state_callback_tag{}, std::move(parent), std::forward<F>(f));
   return std::make_pair(packaged_task<S>(p),
                         future<detail::result_of_t_<S>>(p.as_shared()));
 }
@@ -190,6 +239,11 @@ private:
                               cancelation_token_ptr token,
                               bool cancelable)
       -> std::pair<packaged_task<S>, future<detail::result_of_t_<S>>>;
+  template <typename S, typename F>
+  friend auto detail::package(detail::shared_state_callback_tag,
+                              F&& f,
+                              std::weak_ptr<detail::token_source> parent)
+      -> std::pair<packaged_task<S>, future<detail::result_of_t_<S>>>;
 
   explicit packaged_task(detail::promise_ptr<shared_type> p) : _p(std::move(p))
   {
@@ -206,15 +260,14 @@ auto package(F&& f, cancelation_token_ptr token)
 template <typename S, typename F>
 auto package(F&& f)
 {
-  return detail::package<S>(
-      std::forward<F>(f), std::make_shared<cancelation_token>(), false);
+  return detail::package<S>(std::forward<F>(f), nullptr, false);
 }
 
+/// The cancelation token is only created if someone asks for it
 template <typename S, typename F>
 auto package_cancelable(F&& f)
 {
-  return detail::package<S>(
-      std::forward<F>(f), std::make_shared<cancelation_token>(), true);
+  return detail::package<S>(std::forward<F>(f), nullptr, true);
 }
 
 template <typename S, typename F>
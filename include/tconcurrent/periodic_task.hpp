@@ -31,10 +31,17 @@ public:
 
   ~periodic_task();
 
-  void set_period(duration_type period)
+  /** Run the callback every \p period
+   *
+   * Each run may be delayed by up to \p slack so that it shares a wake-up with
+   * other timers of the executor, see async_wait().
+   */
+  void set_period(duration_type period,
+                  duration_type slack = duration_type::zero())
   {
     scope_lock l(_mutex);
     _period = period;
+    _slack = slack;
   }
 
   template <typename C>
@@ -86,6 +93,7 @@ private:
   State _state{State::Stopped};
 
   duration_type _period;
+  duration_type _slack{};
   std::function<future<void>()> _callback;
 
   future<void> _future;
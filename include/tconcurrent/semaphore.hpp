@@ -1,12 +1,31 @@
 #ifndef TCONCURRENT_SEMAPHORE_HPP
 #define TCONCURRENT_SEMAPHORE_HPP
 
-#include <tconcurrent/concurrent_queue.hpp>
 #include <tconcurrent/future.hpp>
+#include <tconcurrent/promise.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 namespace tconcurrent
 {
 
+/** Counting semaphore
+ *
+ * Acquiring and releasing permits is a single CAS while nobody waits. When an
+ * acquire can not be satisfied, it waits in a FIFO queue, and while anyone
+ * waits, later acquires wait behind it even if there are enough permits for
+ * them, so that big acquires are not starved by small ones.
+ *
+ * The semaphore does not know how many permits will ever be released, so an
+ * acquire of more permits than it will ever hold waits forever, along with
+ * every acquire after it.
+ */
 class semaphore
 {
 public:
@@ -15,7 +34,8 @@ public:
   public:
     scope_lock(scope_lock const& r) = delete;
     scope_lock& operator=(scope_lock const& r) = delete;
-    scope_lock(scope_lock&& r) : s(std::exchange(r.s, nullptr))
+    scope_lock(scope_lock&& r)
+      : s(std::exchange(r.s, nullptr)), n(std::exchange(r.n, 0))
     {
     }
     scope_lock& operator=(scope_lock&& r)
@@ -23,62 +43,175 @@ public:
       if (this != &r)
       {
         if (s)
-          s->release();
+          s->release(n);
         s = std::exchange(r.s, nullptr);
+        n = std::exchange(r.n, 0);
       }
       return *this;
     }
     ~scope_lock()
     {
       if (s)
-        s->release();
+        s->release(n);
     }
 
   private:
     semaphore* s;
+    std::size_t n;
 
-    scope_lock(semaphore* s) : s(s)
+    scope_lock(semaphore* s, std::size_t n) : s(s), n(n)
     {
     }
 
     friend semaphore;
   };
 
-  semaphore(unsigned int N)
+  semaphore(unsigned int N) : _state(N)
+  {
+  }
+
+  semaphore(semaphore const&) = delete;
+  semaphore& operator=(semaphore const&) = delete;
+
+  void release(std::size_t n = 1)
   {
-    for (unsigned int i = 0; i < N; ++i)
-      _queue.push({});
+    auto state = _state.load(std::memory_order_relaxed);
+    while (state != has_waiters)
+      if (_state.compare_exchange_weak(state,
+                                       state + static_cast<std::ptrdiff_t>(n),
+                                       std::memory_order_release,
+                                       std::memory_order_relaxed))
+        return;
+    release_to_waiters(n);
   }
 
-  void release()
+  /** Acquire \p n permits, the returned future is ready when they are
+   *
+   * \p n must not exceed the number of permits the semaphore can hold at once,
+   * see the class documentation.
+   */
+  future<void> acquire(std::size_t n = 1)
   {
-    _queue.push({});
+    if (try_acquire(n))
+      return make_ready_future();
+    return wait(n);
   }
 
-  future<void> acquire()
+  /// Acquire \p n permits if they are available and nobody waits for permits
+  bool try_acquire(std::size_t n = 1)
   {
-    return _queue.pop().and_then(get_synchronous_executor(),
-                                 [](auto const&) {});
+    auto const needed = static_cast<std::ptrdiff_t>(n);
+    auto state = _state.load(std::memory_order_relaxed);
+    // has_waiters is negative, so it fails the check too
+    while (state >= needed)
+      if (_state.compare_exchange_weak(state,
+                                       state - needed,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed))
+        return true;
+    return false;
   }
 
-  future<scope_lock> get_scope_lock()
+  /** Acquire \p n permits and release them when the scope_lock is destroyed
+   *
+   * The same limit on \p n as for acquire() applies.
+   */
+  future<scope_lock> get_scope_lock(std::size_t n = 1)
   {
-    return _queue.pop().and_then(
+    if (try_acquire(n))
+      return make_ready_future(scope_lock(this, n));
+    return wait(n).and_then(
         get_synchronous_executor(),
-        [this](auto const&) { return scope_lock(this); });
+        [this, n](auto const&) { return scope_lock(this, n); });
   }
 
+  /// Number of available permits
   std::size_t count() const
   {
-    return _queue.size();
+    auto const state = _state.load(std::memory_order_relaxed);
+    if (state != has_waiters)
+      return static_cast<std::size_t>(state);
+    std::lock_guard<std::mutex> l(_mutex);
+    return _available;
   }
 
 private:
-  struct token
+  struct waiter
   {
+    std::size_t n;
+    promise<void> prom;
   };
 
-  concurrent_queue<token> _queue;
+  // Value of _state while there are waiters, the permits are then counted in
+  // _available under the lock, so that they go to the waiters first.
+  static constexpr std::ptrdiff_t has_waiters = -1;
+
+  // Number of available permits, or has_waiters. It only goes from and to
+  // has_waiters under the lock.
+  std::atomic<std::ptrdiff_t> _state;
+
+  mutable std::mutex _mutex;
+  std::size_t _available = 0;
+  std::deque<waiter> _waiters;
+
+  future<void> wait(std::size_t n)
+  {
+    auto const needed = static_cast<std::ptrdiff_t>(n);
+    std::lock_guard<std::mutex> l(_mutex);
+    auto state = _state.load(std::memory_order_relaxed);
+    while (state != has_waiters)
+    {
+      // release() may have brought enough permits since try_acquire()
+      if (state >= needed)
+      {
+        if (_state.compare_exchange_weak(state,
+                                         state - needed,
+                                         std::memory_order_acquire,
+                                         std::memory_order_relaxed))
+          return make_ready_future();
+      }
+      else if (_state.compare_exchange_weak(state,
+                                            has_waiters,
+                                            std::memory_order_acquire,
+                                            std::memory_order_relaxed))
+      {
+        assert(_waiters.empty());
+        _available = static_cast<std::size_t>(state);
+        break;
+      }
+    }
+    _waiters.push_back({n, {}});
+    return _waiters.back().prom.get_future();
+  }
+
+  void release_to_waiters(std::size_t n)
+  {
+    std::vector<promise<void>> ready;
+    {
+      std::lock_guard<std::mutex> l(_mutex);
+      auto state = _state.load(std::memory_order_relaxed);
+      // the waiters may have been served by another release() in the meantime
+      while (state != has_waiters)
+        if (_state.compare_exchange_weak(state,
+                                         state + static_cast<std::ptrdiff_t>(n),
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed))
+          return;
+
+      _available += n;
+      while (!_waiters.empty() && _waiters.front().n <= _available)
+      {
+        _available -= _waiters.front().n;
+        ready.push_back(std::move(_waiters.front().prom));
+        _waiters.pop_front();
+      }
+      if (_waiters.empty())
+        _state.store(static_cast<std::ptrdiff_t>(std::exchange(_available, 0)),
+                     std::memory_order_release);
+    }
+    for (auto& prom : ready)
+      prom.set_value({});
+  }
 };
 }
 
@@ -126,7 +126,7 @@ public:
   void yield();
 
 private:
-  std::string name;
+  task_name name;
 
   executor executor_;
 
@@ -146,8 +146,8 @@ private:
   coroutine_control* previous_coroutine = nullptr;
 
   template <typename E, typename F>
-  coroutine_control(std::string name, E&& e, F&& f)
-    : name(std::move(name))
+  coroutine_control(task_name name, E&& e, F&& f)
+    : name(name)
     , executor_(std::forward<E>(e))
     , salloc(boost::context::stack_traits::default_size() * 2)
     , stack(salloc.allocate())
@@ -633,7 +633,7 @@ struct run_resumable_sender
 
   E executor;
   F cb;
-  std::string name;
+  task_name name;
 
   template <typename R>
   void submit(R&& r)
@@ -689,23 +689,23 @@ struct run_resumable_sender
 }
 
 template <typename E, typename F, typename... Args>
-auto run_resumable(E&& executor, std::string name, F&& cb, Args&&... args)
+auto run_resumable(E&& executor, task_name name, F&& cb, Args&&... args)
 {
   auto wrap = [cb = std::forward<F>(cb),
                args = std::make_tuple(std::forward<Args>(args)...)]() mutable
       -> decltype(auto) { return std::apply(std::move(cb), std::move(args)); };
   return detail::run_resumable_sender<std::decay_t<E>, decltype(wrap)>{
-      std::forward<E>(executor), std::move(wrap), std::move(name)};
+      std::forward<E>(executor), std::move(wrap), name};
 }
 
 template <typename E, typename F>
-auto async_resumable(E&& executor, std::string const& name, F&& cb)
+auto async_resumable(E&& executor, task_name name, F&& cb)
 {
-  auto fullName = name + " (" + typeid(F).name() + ")";
+  auto const fullName = task_name(name.name(), &typeid(F));
 
   return lazy::connect(
       lazy::async(executor, fullName),
-      lazy::run_resumable(executor, std::move(fullName), std::forward<F>(cb)));
+      lazy::run_resumable(executor, fullName, std::forward<F>(cb)));
 }
 }
 
@@ -77,7 +77,7 @@ struct task_promise_base
   fu2::function<void()> cont;
   std::exception_ptr exc;
   executor executor;
-  std::string name;
+  task_name name;
 };
 
 template <typename T>
@@ -376,7 +376,7 @@ struct sender_awaiter_base
   Sender&& sender;
   std::exception_ptr err;
   executor executor;
-  std::string name;
+  task_name name;
   std::experimental::coroutine_handle<> continuation;
   std::shared_ptr<lazy::cancelation_token> cancelation_token =
       std::make_shared<lazy::cancelation_token>();
@@ -537,7 +537,7 @@ struct sink_task;
 struct sink_promise
 {
   executor executor;
-  std::string name;
+  task_name name;
 
   sink_promise() = default;
   sink_promise(sink_promise const&) = delete;
@@ -673,7 +673,7 @@ struct run_resumable_sender
   using value_types = typename value_types_of<return_type, Tuple>::types;
 
   executor executor;
-  std::string name;
+  task_name name;
   Awaitable awaitable;
 
   template <typename R>
@@ -685,7 +685,7 @@ struct run_resumable_sender
     coro->coro =
         detail::coro_runner<return_type>::run(*coro, std::move(awaitable)).coro;
     coro->coro.promise().executor = std::move(executor);
-    coro->coro.promise().name = std::move(name);
+    coro->coro.promise().name = name;
     coro->coro.resume();
     // we just ran the coroutine, it may have died right away, so we need to
     // check
@@ -697,26 +697,26 @@ struct run_resumable_sender
 }
 
 template <typename E, typename F, typename... Args>
-auto run_resumable(E&& executor, std::string name, F&& f, Args&&... args)
+auto run_resumable(E&& executor, task_name name, F&& f, Args&&... args)
 {
   auto awaitable = std::invoke(std::forward<F>(f), std::forward<Args>(args)...);
 
   return detail::run_resumable_sender<std::decay_t<E>, decltype(awaitable)>{
-      std::forward<E>(executor), std::move(name), std::move(awaitable)};
+      std::forward<E>(executor), name, std::move(awaitable)};
 }
 
 template <typename E, typename F>
-auto async_resumable(E&& executor, std::string const& name, F&& cb)
+auto async_resumable(E&& executor, task_name name, F&& cb)
 {
   using return_task_type = std::decay_t<decltype(cb())>;
   using return_type = typename return_task_type::value_type;
 
-  auto fullName = name + " (" + typeid(F).name() + ")";
+  auto const fullName = task_name(name.name(), &typeid(F));
 
   return lazy::connect(lazy::async(executor, fullName),
                        lazy::run_resumable(
                            executor,
-                           std::move(fullName),
+                           fullName,
                            [](std::decay_t<F> cb) -> cotask<return_type> {
                              co_return co_await cb();
                            },
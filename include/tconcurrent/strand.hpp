@@ -0,0 +1,61 @@
+#ifndef TCONCURRENT_STRAND_HPP
+#define TCONCURRENT_STRAND_HPP
+
+#include <tconcurrent/detail/export.hpp>
+#include <tconcurrent/executor.hpp>
+#include <tconcurrent/task_name.hpp>
+
+#include <function2/function2.hpp>
+
+#include <cstddef>
+#include <memory>
+
+namespace tconcurrent
+{
+/** Executor that runs its tasks one at a time, in order, on another executor
+ *
+ * Tasks posted to a strand run in the order they were posted and never
+ * overlap, even on a multi-threaded executor, so a strand can stand for a
+ * single-threaded execution context. While they run, is_in_this_context()
+ * returns true.
+ *
+ * Tasks are queued in a lock-free queue, and only one task at a time is posted
+ * to the underlying executor to run them. It runs up to tasks_per_run tasks
+ * before posting itself again so that the other tasks of the underlying
+ * executor get a chance to run.
+ *
+ * The strand must outlive the executors that refer to it, but the tasks that
+ * are still queued when it is destroyed run nonetheless.
+ */
+class TCONCURRENT_EXPORT strand
+{
+public:
+  static constexpr std::size_t tasks_per_run = 32;
+
+  explicit strand(executor e);
+
+  strand(strand const&) = delete;
+  strand(strand&&) = delete;
+  strand& operator=(strand const&) = delete;
+  strand& operator=(strand&&) = delete;
+
+  void post(fu2::unique_function<void()> work, task_name name = {});
+
+  boost::asio::io_context& get_io_service();
+
+  /// Always true, tasks never run concurrently
+  bool is_single_threaded() const;
+  /// True while a task of this strand runs on the current thread
+  bool is_in_this_context() const;
+
+  void signal_error(std::exception_ptr const& e);
+  void stop_before_fork();
+  void resume_after_fork();
+
+private:
+  struct state;
+  std::shared_ptr<state> _state;
+};
+}
+
+#endif
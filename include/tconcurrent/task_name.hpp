@@ -0,0 +1,82 @@
+#ifndef TCONCURRENT_TASK_NAME_HPP
+#define TCONCURRENT_TASK_NAME_HPP
+
+#include <string>
+#include <string_view>
+#include <typeinfo>
+
+namespace tconcurrent
+{
+/** Name of a task, for debugging purposes
+ *
+ * This is a non-owning handle made of a string and an optional type_info
+ * pointer, usually the type of the callable that runs the task. It does not
+ * allocate, the full name is only built when to_string() is called, e.g. when
+ * a task trace handler is installed.
+ *
+ * The string must outlive every task that is named after it, a string literal
+ * is what you usually want. Constructing a task_name from a std::string does
+ * not compile, since nothing would keep the string alive. A string with static
+ * storage can still be given explicitly as a std::string_view.
+ */
+class task_name
+{
+public:
+  constexpr task_name() noexcept = default;
+
+  constexpr task_name(char const* name) noexcept
+    : _name(name ? std::string_view(name) : std::string_view())
+  {
+  }
+
+  constexpr task_name(std::string_view name,
+                      std::type_info const* type = nullptr) noexcept
+    : _name(name), _type(type)
+  {
+  }
+
+  // The string may be destroyed before the task runs
+  task_name(std::string const&) = delete;
+  task_name(std::string&&) = delete;
+
+  constexpr std::string_view name() const noexcept
+  {
+    return _name;
+  }
+
+  constexpr std::type_info const* type() const noexcept
+  {
+    return _type;
+  }
+
+  constexpr bool empty() const noexcept
+  {
+    return _name.empty() && !_type;
+  }
+
+  /// Build the full name, in the form "name (type)"
+  std::string to_string() const
+  {
+    if (!_type)
+      return std::string(_name);
+
+    char const* const type = _type->name();
+    std::string ret;
+    ret.reserve(_name.size() + std::char_traits<char>::length(type) + 3);
+    ret.append(_name).append(" (").append(type).append(")");
+    return ret;
+  }
+
+  /// Allow executors that take a std::string name to keep working
+  operator std::string() const
+  {
+    return to_string();
+  }
+
+private:
+  std::string_view _name;
+  std::type_info const* _type = nullptr;
+};
+}
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef TCONCURRENT_TASK_PRIORITY_HPP
+#define TCONCURRENT_TASK_PRIORITY_HPP
+
+#include <cstddef>
+
+namespace tconcurrent
+{
+/** Priority class of a task
+ *
+ * Execution contexts that support priorities run the pending tasks of a higher
+ * class first, and tasks of the same class in the order they were posted. The
+ * others ignore the priority.
+ */
+enum class task_priority
+{
+  high,
+  normal,
+  low,
+};
+
+constexpr std::size_t nb_task_priorities = 3;
+}
+
+#endif
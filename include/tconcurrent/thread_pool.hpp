@@ -2,14 +2,20 @@
 #define TCONCURRENT_THREAD_POOL_H
 
 #include <atomic>
+#include <chrono>
 #include <memory>
+#include <optional>
 #include <thread>
+#include <vector>
 
 #include <function2/function2.hpp>
 
 #include <tconcurrent/detail/boost_fwd.hpp>
 #include <tconcurrent/detail/export.hpp>
 #include <tconcurrent/future.hpp>
+#include <tconcurrent/latency_histogram.hpp>
+#include <tconcurrent/task_name.hpp>
+#include <tconcurrent/task_priority.hpp>
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -29,9 +35,114 @@ class TCONCURRENT_EXPORT thread_pool
 {
 public:
   using error_handler_cb = fu2::function<void(std::exception_ptr const&)>;
+  /// The name is only built when a handler is set
   using task_trace_handler_cb = fu2::function<void(
       std::string const& name, std::chrono::steady_clock::duration dur)>;
 
+  /** How tasks given to post() are dispatched to the worker threads
+   *
+   * - shared_queue: every task goes through a shared queue, in FIFO order
+   *   within a priority class.
+   * - work_stealing: each worker has its own deque. Tasks posted from a worker
+   *   go to that worker's deque and idle workers steal from the others. Tasks
+   *   posted from outside the pool go through a shared injection queue. The
+   *   io_context is only used for timers and asio I/O. There is no ordering
+   *   guarantee between tasks, but pending high priority tasks are picked
+   *   before normal ones, and normal ones before low ones.
+   */
+  enum class scheduling
+  {
+    shared_queue,
+    work_stealing,
+  };
+
+  /// Indices of logical CPUs
+  using cpu_list = std::vector<unsigned int>;
+
+  struct start_config
+  {
+    /// Number of threads, or minimum number of threads in elastic mode
+    unsigned int thread_count = 1;
+    scheduling sched = scheduling::shared_queue;
+    /** Where to pin the workers, worker i runs on the CPUs of
+     * placement[i % placement.size()]
+     *
+     * Each entry is a locality domain, e.g. a NUMA node, see numa_nodes().
+     * When empty, workers are not pinned and there is a single domain.
+     */
+    std::vector<cpu_list> placement;
+    /** Enables the elastic mode when greater than thread_count
+     *
+     * The pool then starts thread_count threads, and spawns more, up to
+     * max_thread_count, when tasks wait for longer than grow_latency in the
+     * queues, or when no queued task was picked during grow_latency, e.g.
+     * because all the threads are blocked. At most one thread is spawned per
+     * grow_latency. Threads above thread_count that stay idle for
+     * idle_timeout exit.
+     */
+    unsigned int max_thread_count = 0;
+    std::chrono::steady_clock::duration grow_latency =
+        std::chrono::milliseconds(1);
+    std::chrono::steady_clock::duration idle_timeout = std::chrono::seconds(10);
+    /** Maximum number of compensation threads
+     *
+     * When a worker enters a blocking_region, e.g. by waiting on a future, the
+     * pool wakes up or spawns a compensation thread that runs tasks until the
+     * worker leaves the region. Compensation threads that stay idle for
+     * idle_timeout exit. Single-threaded pools never compensate, their tasks
+     * must not run concurrently.
+     */
+    unsigned int max_compensation_threads = 16;
+    /** Record the queue wait and run time of each task in get_metrics()
+     *
+     * This reads the clock three times per task.
+     */
+    bool record_latencies = false;
+  };
+
+  /// Activity of the pool since it was created, see get_metrics()
+  struct metrics
+  {
+    std::uint64_t tasks_posted = 0;
+    /// Tasks that started running
+    std::uint64_t tasks_executed = 0;
+    /// Tasks taken from another worker's deque, only in work_stealing mode
+    std::uint64_t tasks_stolen = 0;
+    /// Tasks waiting to be picked when the snapshot was taken
+    std::size_t queue_depth = 0;
+    /// Time between post() and the start of the task
+    latency_histogram queue_wait;
+    latency_histogram run_time;
+  };
+
+  /** Locality hint of a task
+   *
+   * In work_stealing mode, the task is queued in the given domain, the workers
+   * of that domain pick it before the others do. Thieves also steal from the
+   * workers of their own domain first. Without a hint, a task posted from a
+   * worker stays in that worker's domain.
+   *
+   * The hint is ignored in shared_queue mode.
+   */
+  struct locality
+  {
+    unsigned int domain;
+  };
+
+  /** Get the CPUs this process may run on
+   *
+   * This is empty on platforms where threads can not be pinned.
+   */
+  static cpu_list available_cpus();
+
+  /** Get the available CPUs of each NUMA node, in node order
+   *
+   * Nodes without available CPUs are skipped. When the system does not
+   * expose NUMA information, all the available CPUs are returned as a single
+   * node.
+   */
+  static std::vector<cpu_list> numa_nodes();
+
   thread_pool(thread_pool const&) = delete;
   thread_pool(thread_pool&&) = delete;
   thread_pool& operator=(thread_pool const&) = delete;
@@ -40,7 +151,14 @@ public:
   thread_pool();
   ~thread_pool();
 
-  void start(unsigned int thread_count);
+  void start(unsigned int thread_count,
+             scheduling sched = scheduling::shared_queue);
+  /** Start the pool as described by config
+   *
+   * \throws std::invalid_argument if a CPU of the placement is not available,
+   * or if the elastic mode is requested with a thread_count of 0
+   */
+  void start(start_config config);
   void stop(bool cancel_work = false);
 
   void stop_before_fork();
@@ -51,6 +169,22 @@ public:
   bool is_in_this_context() const;
   bool is_single_threaded() const;
 
+  /// Number of threads currently started, it varies in elastic mode
+  unsigned int thread_count() const;
+
+  /** Take a snapshot of the metrics of the pool
+   *
+   * Each thread keeps its own counters, this sums them up without stopping
+   * the pool, so the figures may be off by the tasks that run meanwhile. The
+   * histograms are empty unless start_config::record_latencies is set.
+   */
+  metrics get_metrics() const;
+
+  /// Number of locality domains, 1 when the workers are not pinned
+  unsigned int domain_count() const;
+  /// Locality domain of the calling worker, if it is a worker of this pool
+  std::optional<locality> current_locality() const;
+
   boost::asio::io_context& get_io_service();
 
   /** Call this function to become a worker of this threadpool
@@ -58,7 +192,36 @@ public:
    */
   void run_thread();
 
-  void post(fu2::unique_function<void()> work, std::string name = {});
+  /// Post a task with normal priority
+  void post(fu2::unique_function<void()> work, task_name name = {});
+
+  /** Post a task with the given priority
+   *
+   * Pending tasks of a higher class run first. To avoid starvation, a pending
+   * task of a lower class is still picked at least once every 16 tasks of the
+   * higher classes.
+   *
+   * In shared_queue mode, the pool only queues tasks by priority once a task
+   * was posted with a priority other than normal. The normal tasks posted
+   * before that are not overtaken.
+   */
+  void post(fu2::unique_function<void()> work,
+            task_priority priority,
+            task_name name = {});
+
+  /// Post a task with a locality hint, see locality
+  void post(fu2::unique_function<void()> work,
+            locality where,
+            task_priority priority = task_priority::normal,
+            task_name name = {});
+
+  /** Post several tasks at once
+   *
+   * This takes the queue lock once and wakes up at most as many workers as
+   * there are tasks. The tasks have normal priority.
+   */
+  void post_bulk(std::vector<fu2::unique_function<void()>> works,
+                 task_name name = {});
 
   void set_error_handler(error_handler_cb cb);
   void signal_error(std::exception_ptr const& e);
@@ -0,0 +1,17 @@
+#ifndef TCONCURRENT_TIMED_OUT_HPP
+#define TCONCURRENT_TIMED_OUT_HPP
+
+#include <stdexcept>
+
+namespace tconcurrent
+{
+struct timed_out : std::exception
+{
+  const char* what() const noexcept override
+  {
+    return "operation timed out";
+  }
+};
+}
+
+#endif
@@ -5,9 +5,14 @@
 
 #include <flags/flags.hpp>
 
+#include <tconcurrent/detail/node_pool.hpp>
 #include <tconcurrent/promise.hpp>
 
 #include <algorithm>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace tconcurrent
 {
@@ -40,6 +45,18 @@ struct is_future<shared_future<T>> : std::true_type
 {
 };
 
+template <typename... F>
+constexpr bool are_futures_v = (is_future<std::decay_t<F>>::value && ...);
+
+template <typename F>
+using future_canceler_t = decltype(std::declval<F&>().make_canceler());
+
+template <typename... Cancelers>
+void call_cancelers(std::tuple<Cancelers...> const& cancelers)
+{
+  std::apply([](auto const&... canceler) { (canceler(), ...); }, cancelers);
+}
+
 template <typename F>
 class when_all_callback
 {
@@ -109,7 +126,8 @@ private:
  *
  * \return a future<std::vector<future<T>>> that always finishes with a value.
  */
-template <typename InputIterator>
+template <typename InputIterator,
+          typename = std::enable_if_t<!detail::is_future<InputIterator>::value>>
 future<std::vector<typename std::iterator_traits<InputIterator>::value_type>>
 when_all(InputIterator first, InputIterator last)
 {
@@ -135,6 +153,125 @@ when_all(InputIterator first, InputIterator last)
   return cb.get_future();
 }
 
+namespace detail
+{
+template <typename F>
+struct when_all_values_shared
+{
+  using value_type = typename F::value_type;
+  // the values are written in place when they can be default constructed
+  using slot_type =
+      std::conditional_t<std::is_default_constructible_v<value_type>,
+                         value_type,
+                         std::optional<value_type>>;
+
+  // continuations write their slots concurrently, the wrapper keeps
+  // std::vector<bool> from packing them in the same word
+  struct slot
+  {
+    slot_type value;
+  };
+
+  std::vector<slot> slots;
+  std::vector<future_canceler_t<F>> cancelers;
+  std::atomic<std::size_t> count{0};
+  std::atomic<bool> failed{false};
+  promise<std::vector<value_type>> prom;
+  cancelation_token::scope_canceler canceler;
+
+  explicit when_all_values_shared(std::vector<F>& futures)
+    : slots(futures.size())
+  {
+    cancelers.reserve(futures.size());
+    for (auto& future : futures)
+      cancelers.push_back(future.make_canceler());
+  }
+
+  void request_cancel()
+  {
+    for (auto const& canceler : cancelers)
+      canceler();
+  }
+
+  void finish(std::size_t index, F& future)
+  {
+    if (future.has_exception())
+    {
+      if (failed.exchange(true))
+        return;
+      canceler = {};
+      request_cancel();
+      prom.set_exception(future.get_exception());
+      return;
+    }
+
+    if constexpr (std::is_same_v<value_type, tvoid>)
+      slots[index].value = tvoid{};
+    else
+      slots[index].value = future.get();
+    if (++count != slots.size())
+      return;
+
+    canceler = {};
+    std::vector<value_type> values;
+    values.reserve(slots.size());
+    for (auto& slot : slots)
+    {
+      if constexpr (std::is_same_v<slot_type, value_type>)
+        values.push_back(std::move(slot.value));
+      else
+        values.push_back(std::move(*slot.value));
+    }
+    prom.set_value(std::move(values));
+  }
+};
+}
+
+/** Get a future of the values of the given futures
+ *
+ * The values are stored in a vector in the order of the input range, futures
+ * of void give a vector of tvoid.
+ *
+ * As soon as one of the futures finishes with an error, a cancelation is
+ * requested on the other ones and the returned future finishes with that
+ * error, without waiting for them.
+ *
+ * If a cancelation is requested on the returned future, the cancelation request
+ * is propagated to the futures given as argument.
+ *
+ * \return a future<std::vector<T>>
+ */
+template <typename InputIterator>
+future<std::vector<
+    typename std::iterator_traits<InputIterator>::value_type::value_type>>
+when_all_values(InputIterator first, InputIterator last)
+{
+  using future_type = typename std::iterator_traits<InputIterator>::value_type;
+
+  static_assert(detail::is_future<future_type>::value,
+                "when_all_values must be called on iterators of futures");
+
+  using shared = detail::when_all_values_shared<future_type>;
+
+  if (first == last)
+    return make_ready_future(std::vector<typename shared::value_type>{});
+
+  std::vector<future_type> futlist;
+  for (InputIterator it = first; it != last; ++it)
+    futlist.push_back(*it);
+
+  auto const p = detail::make_pooled_shared<shared>(futlist);
+  p->canceler = p->prom.get_cancelation_token().make_scope_canceler(
+      [p] { p->request_cancel(); });
+
+  for (std::size_t index = 0; index < futlist.size(); ++index)
+    futlist[index].then(
+        get_synchronous_executor(),
+        [p, index](future_type f) { p->finish(index, f); });
+
+  return p->prom.get_future();
+}
+
 template <class Sequence>
 struct when_any_result
 {
@@ -222,7 +359,8 @@ private:
  * \return a future<when_any_result<std::vector<future<T>>>> that always
  * finishes with a value.
  */
-template <typename InputIterator>
+template <typename InputIterator,
+          typename = std::enable_if_t<!detail::is_future<InputIterator>::value>>
 future<when_any_result<
     std::vector<typename std::iterator_traits<InputIterator>::value_type>>>
 when_any(InputIterator first,
@@ -245,6 +383,161 @@ when_any(InputIterator first,
 
   return cb.get_future();
 }
+
+namespace detail
+{
+template <typename... F>
+struct when_all_tuple_shared
+{
+  std::tuple<F...> finished_futures;
+  std::tuple<future_canceler_t<F>...> cancelers;
+  std::atomic<unsigned int> count{0};
+  promise<std::tuple<F...>> prom;
+  cancelation_token::scope_canceler canceler;
+
+  explicit when_all_tuple_shared(F&... futures)
+    : cancelers(futures.make_canceler()...)
+  {
+  }
+
+  template <std::size_t I>
+  void finish(std::tuple_element_t<I, std::tuple<F...>> future)
+  {
+    std::get<I>(finished_futures) = std::move(future);
+    if (++count == sizeof...(F))
+    {
+      canceler = {};
+      prom.set_value(std::move(finished_futures));
+    }
+  }
+};
+
+template <std::size_t... I, typename... F>
+future<std::tuple<F...>> when_all_tuple(std::index_sequence<I...>,
+                                        F... futures)
+{
+  auto const p = make_pooled_shared<when_all_tuple_shared<F...>>(futures...);
+  p->canceler = p->prom.get_cancelation_token().make_scope_canceler(
+      [p] { call_cancelers(p->cancelers); });
+  (futures.then(get_synchronous_executor(),
+                [p](F f) { p->template finish<I>(std::move(f)); }),
+   ...);
+  return p->prom.get_future();
+}
+
+template <typename... F>
+struct when_any_tuple_shared
+{
+  using result_type = when_any_result<std::tuple<F...>>;
+
+  std::tuple<F...> futures;
+  std::tuple<future_canceler_t<F>...> cancelers;
+  when_any_options const options;
+  std::atomic<bool> triggered{false};
+  std::size_t index = 0;
+  // the first future to finish and when_any_tuple(), once it has stored the
+  // futures, both release one, the last one sets the promise
+  std::atomic<unsigned int> pending{2};
+  promise<result_type> prom;
+  cancelation_token::scope_canceler canceler;
+
+  when_any_tuple_shared(when_any_options options, F&... futures)
+    : cancelers(futures.make_canceler()...), options(options)
+  {
+  }
+
+  void trigger(std::size_t i)
+  {
+    if (triggered.exchange(true))
+      return;
+    index = i;
+    release();
+  }
+
+  void release()
+  {
+    if (--pending)
+      return;
+    canceler = {};
+    if (options & when_any_options::auto_cancel)
+      std::apply(
+          [this](auto const&... cancelers) {
+            std::size_t i = 0;
+            ((i++ != index ? cancelers() : void()), ...);
+          },
+          cancelers);
+    prom.set_value(result_type{index, std::move(futures)});
+  }
+};
+
+template <std::size_t... I, typename... F>
+future<when_any_result<std::tuple<F...>>> when_any_tuple(
+    std::index_sequence<I...>, when_any_options options, F... futures)
+{
+  auto const p =
+      make_pooled_shared<when_any_tuple_shared<F...>>(options, futures...);
+  p->canceler = p->prom.get_cancelation_token().make_scope_canceler(
+      [p] { call_cancelers(p->cancelers); });
+  (futures.then(get_synchronous_executor(), [p](F const&) { p->trigger(I); }),
+   ...);
+  p->futures = std::tuple<F...>(std::move(futures)...);
+  p->release();
+  return p->prom.get_future();
+}
+}
+
+/** Get a future that will be ready when all the given futures are ready
+ *
+ * This is the fixed-arity version of when_all(). The futures and their
+ * cancelers are stored in a tuple instead of vectors, and the cancelers are not
+ * type-erased. The returned future and the continuations set on the given
+ * futures still have their own states. Futures must be given by rvalue, shared
+ * futures may also be copied.
+ *
+ * \return a future<std::tuple<future<T>...>> that always finishes with a value.
+ */
+template <typename... Futures,
+          typename = std::enable_if_t<detail::are_futures_v<Futures...>>>
+future<std::tuple<std::decay_t<Futures>...>> when_all(Futures&&... futures)
+{
+  if constexpr (sizeof...(Futures) == 0)
+    return make_ready_future(std::tuple<>{});
+  else
+    return detail::when_all_tuple(
+        std::index_sequence_for<Futures...>{},
+        std::decay_t<Futures>(std::forward<Futures>(futures))...);
+}
+
+/** Get a future that will be ready when any one of the given futures is ready
+ *
+ * This is the fixed-arity version of when_any(), see the fixed-arity
+ * when_all(). If no future is given, returns a ready future with an index of
+ * size_t(-1).
+ *
+ * \return a future<when_any_result<std::tuple<future<T>...>>> that always
+ * finishes with a value.
+ */
+template <typename... Futures,
+          typename = std::enable_if_t<detail::are_futures_v<Futures...>>>
+future<when_any_result<std::tuple<std::decay_t<Futures>...>>> when_any(
+    when_any_options options, Futures&&... futures)
+{
+  if constexpr (sizeof...(Futures) == 0)
+    return make_ready_future(when_any_result<std::tuple<>>{size_t(-1), {}});
+  else
+    return detail::when_any_tuple(
+        std::index_sequence_for<Futures...>{},
+        options,
+        std::decay_t<Futures>(std::forward<Futures>(futures))...);
+}
+
+template <typename... Futures,
+          typename = std::enable_if_t<detail::are_futures_v<Futures...>>>
+future<when_any_result<std::tuple<std::decay_t<Futures>...>>> when_any(
+    Futures&&... futures)
+{
+  return when_any(when_any_options::none, std::forward<Futures>(futures)...);
+}
 }
 
 #endif
@@ -0,0 +1,102 @@
+#ifndef TCONCURRENT_WITH_TIMEOUT_HPP
+#define TCONCURRENT_WITH_TIMEOUT_HPP
+
+#include <tconcurrent/detail/node_pool.hpp>
+#include <tconcurrent/detail/timer_wheel.hpp>
+#include <tconcurrent/executor.hpp>
+#include <tconcurrent/future.hpp>
+#include <tconcurrent/promise.hpp>
+#include <tconcurrent/timed_out.hpp>
+
+#include <chrono>
+#include <memory>
+#include <optional>
+
+namespace tconcurrent
+{
+namespace detail
+{
+// The timer is also the state shared by the two sides, whichever makes
+// timer_wheel::cancel() fail came second and does nothing.
+template <typename T>
+struct timeout_timer final : timer_node
+{
+  using canceler_type = decltype(std::declval<future<T>&>().make_canceler());
+
+  timer_wheel* wheel;
+  promise<T> prom;
+  std::optional<canceler_type> cancel_input;
+
+  explicit timeout_timer(timer_wheel& wheel) : wheel(&wheel)
+  {
+  }
+
+  void fire() override
+  {
+    prom.get_cancelation_token().pop_cancelation_callback();
+    (*cancel_input)();
+    prom.set_exception(std::make_exception_ptr(timed_out()));
+  }
+
+  void finish(future<T>& fut)
+  {
+    if (!wheel->cancel(*this))
+      return;
+
+    prom.get_cancelation_token().pop_cancelation_callback();
+    try
+    {
+      prom.set_value(fut.get());
+    }
+    catch (...)
+    {
+      prom.set_exception(std::current_exception());
+    }
+  }
+};
+}
+
+/** Get a future that finishes like \p fut, or with timed_out after \p timeout
+ *
+ * When the timeout expires first, a cancelation is requested on \p fut. When
+ * \p fut finishes first, the timer is canceled. A cancelation request on the
+ * returned future is propagated to \p fut.
+ *
+ * The timer is armed on the io_context of \p executor. It also holds the
+ * promise of the returned future, so there is no other shared state.
+ */
+template <typename T>
+future<T> with_timeout(executor executor,
+                       future<T> fut,
+                       std::chrono::steady_clock::duration timeout)
+{
+  auto& wheel = detail::timer_wheel::get(executor.get_io_service());
+  auto const timer =
+      detail::make_pooled_shared<detail::timeout_timer<T>>(wheel);
+  auto ret = timer->prom.get_future();
+  timer->cancel_input.emplace(fut.make_canceler());
+
+  // the timer owns the callback through its promise, hence the weak_ptr
+  timer->prom.get_cancelation_token().push_cancelation_callback(
+      [weak_timer = std::weak_ptr<detail::timeout_timer<T>>(timer)] {
+        if (auto const timer = weak_timer.lock())
+          (*timer->cancel_input)();
+      });
+
+  wheel.arm(timer, std::chrono::steady_clock::now() + timeout);
+
+  fut.then(get_synchronous_executor(),
+           [timer](future<T> fut) { timer->finish(fut); });
+
+  return ret;
+}
+
+template <typename T>
+future<T> with_timeout(future<T> fut,
+                       std::chrono::steady_clock::duration timeout)
+{
+  return with_timeout(get_default_executor(), std::move(fut), timeout);
+}
+}
+
+#endif
@@ -1,9 +1,7 @@
 #include <tconcurrent/async_wait.hpp>
 
-#include <atomic>
-
-#include <boost/asio/steady_timer.hpp>
-
+#include <tconcurrent/detail/node_pool.hpp>
+#include <tconcurrent/detail/timer_wheel.hpp>
 #include <tconcurrent/packaged_task.hpp>
 #include <tconcurrent/promise.hpp>
 
@@ -13,42 +11,40 @@ namespace tconcurrent
 namespace detail
 {
 
-struct async_wait_data
+struct async_wait_timer final : timer_node
 {
-  boost::asio::steady_timer timer;
   promise<void> prom;
-  std::atomic<bool> fired{false};
 
-  template <typename Delay>
-  async_wait_data(boost::asio::io_context& io, Delay delay) : timer(io, delay)
+  void fire() override
   {
+    prom.get_cancelation_token().pop_cancelation_callback();
+    prom.set_value({});
   }
 };
 }
 
 future<void> async_wait(executor executor,
-                        std::chrono::steady_clock::duration delay)
+                        std::chrono::steady_clock::duration delay,
+                        std::chrono::steady_clock::duration slack)
 {
-  auto const data = std::make_shared<detail::async_wait_data>(
-      executor.get_io_service(), delay);
-
-  data->prom.get_cancelation_token().push_cancelation_callback([data] {
-    if (data->fired.exchange(true))
-      return;
-
-    data->timer.cancel();
-    data->prom.get_cancelation_token().pop_cancelation_callback();
-    data->prom.set_exception(std::make_exception_ptr(operation_canceled()));
-  });
-
-  data->timer.async_wait([data](boost::system::error_code const&) mutable {
-    if (!data->fired.exchange(true))
-    {
-      data->prom.get_cancelation_token().pop_cancelation_callback();
-      data->prom.set_value({});
-    }
-  });
-
-  return data->prom.get_future();
+  auto& wheel = detail::timer_wheel::get(executor.get_io_service());
+  auto const timer = detail::make_pooled_shared<detail::async_wait_timer>();
+  auto fut = timer->prom.get_future();
+
+  // the timer owns the callback through its promise, hence the weak_ptr
+  timer->prom.get_cancelation_token().push_cancelation_callback(
+      [&wheel, weak_timer = std::weak_ptr<detail::async_wait_timer>(timer)] {
+        auto const timer = weak_timer.lock();
+        if (!timer || !wheel.cancel(*timer))
+          return;
+
+        timer->prom.get_cancelation_token().pop_cancelation_callback();
+        timer->prom.set_exception(
+            std::make_exception_ptr(operation_canceled()));
+      });
+
+  wheel.arm(timer, std::chrono::steady_clock::now() + delay, slack);
+
+  return fut;
 }
 }
@@ -34,7 +34,10 @@ extern "C"
 
 namespace tconcurrent
 {
-future<void> async_wait(executor, std::chrono::steady_clock::duration delay)
+// setTimeout already lets the browser group timers, the slack is not needed
+future<void> async_wait(executor,
+                        std::chrono::steady_clock::duration delay,
+                        std::chrono::steady_clock::duration)
 {
   EM_ASM(if (!Module.tconcurrent_await_id) {
     Module.tconcurrent_last_timeout_id = 1;
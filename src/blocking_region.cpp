@@ -0,0 +1,32 @@
+#include <tconcurrent/blocking_region.hpp>
+
+#if !TCONCURRENT_USE_THREAD_LOCAL
+#include <boost/thread/tss.hpp>
+#endif
+
+namespace tconcurrent
+{
+namespace detail
+{
+#if TCONCURRENT_USE_THREAD_LOCAL
+blocking_handler*& current_blocking_handler()
+{
+  static thread_local blocking_handler* handler = nullptr;
+  return handler;
+}
+#else
+namespace
+{
+boost::thread_specific_ptr<blocking_handler*> handler;
+}
+
+blocking_handler*& current_blocking_handler()
+{
+  auto p = handler.get();
+  if (!p)
+    handler.reset(p = new blocking_handler*(nullptr));
+  return *p;
+}
+#endif
+}
+}
@@ -22,7 +22,7 @@ namespace
 class default_execution_context
 {
 public:
-  void post(fu2::unique_function<void()> f, std::string name)
+  void post(fu2::unique_function<void()> f, task_name name)
   {
     EM_ASM_(
         {
@@ -0,0 +1,32 @@
+#include <tconcurrent/inline_executor.hpp>
+
+#if !TCONCURRENT_USE_THREAD_LOCAL
+#include <boost/thread/tss.hpp>
+#endif
+
+namespace tconcurrent
+{
+namespace detail
+{
+#if TCONCURRENT_USE_THREAD_LOCAL
+unsigned& inline_execution_depth()
+{
+  static thread_local unsigned depth = 0;
+  return depth;
+}
+#else
+namespace
+{
+boost::thread_specific_ptr<unsigned> depth;
+}
+
+unsigned& inline_execution_depth()
+{
+  auto p = depth.get();
+  if (!p)
+    depth.reset(p = new unsigned(0));
+  return *p;
+}
+#endif
+}
+}
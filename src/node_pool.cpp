@@ -0,0 +1,192 @@
+#include <tconcurrent/detail/node_pool.hpp>
+
+#include <array>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#if !TCONCURRENT_USE_THREAD_LOCAL
+#include <boost/thread/tss.hpp>
+#endif
+
+namespace tconcurrent
+{
+namespace detail
+{
+namespace
+{
+constexpr std::array<std::size_t, 5> size_classes{64, 128, 256, 512, 1024};
+static_assert(size_classes.back() == max_pooled_size);
+constexpr auto nb_size_classes = size_classes.size();
+
+// Blocks move between the threads and the depot by batches
+constexpr std::size_t batch_size = 32;
+// A thread keeps at most that many free blocks of each class
+constexpr std::size_t max_cached = 2 * batch_size;
+// Past that, the blocks that are given back to the depot are freed
+constexpr std::size_t max_depot_batches = 256;
+
+struct free_block
+{
+  free_block* next;
+};
+
+struct batch
+{
+  free_block* head;
+  std::size_t size;
+};
+
+std::size_t size_class_of(std::size_t size)
+{
+  std::size_t i = 0;
+  while (i < nb_size_classes && size > size_classes[i])
+    ++i;
+  return i;
+}
+
+void free_list(free_block* head)
+{
+  while (head)
+    ::operator delete(std::exchange(head, head->next));
+}
+
+struct depot
+{
+  std::mutex mutex;
+  std::array<std::vector<batch>, nb_size_classes> batches;
+
+  void give(std::size_t size_class, batch b)
+  {
+    {
+      std::lock_guard<std::mutex> _(mutex);
+      auto& list = batches[size_class];
+      if (list.size() < max_depot_batches)
+      {
+        list.push_back(b);
+        return;
+      }
+    }
+    free_list(b.head);
+  }
+
+  batch take(std::size_t size_class)
+  {
+    std::lock_guard<std::mutex> _(mutex);
+    auto& list = batches[size_class];
+    if (list.empty())
+      return {nullptr, 0};
+    auto const b = list.back();
+    list.pop_back();
+    return b;
+  }
+};
+
+depot& get_depot()
+{
+  // never destroyed, threads may give their blocks back during static
+  // destruction
+  static auto const d = new depot;
+  return *d;
+}
+
+struct thread_cache
+{
+  std::array<batch, nb_size_classes> lists{};
+
+  thread_cache() = default;
+  thread_cache(thread_cache const&) = delete;
+  thread_cache& operator=(thread_cache const&) = delete;
+
+  ~thread_cache()
+  {
+    for (std::size_t i = 0; i < nb_size_classes; ++i)
+      if (lists[i].head)
+        get_depot().give(i, lists[i]);
+  }
+
+  void* allocate(std::size_t size_class)
+  {
+    auto& list = lists[size_class];
+    if (!list.head)
+      list = get_depot().take(size_class);
+    if (!list.head)
+      return ::operator new(size_classes[size_class]);
+    --list.size;
+    return std::exchange(list.head, list.head->next);
+  }
+
+  void deallocate(void* p, std::size_t size_class)
+  {
+    auto& list = lists[size_class];
+    list.head = new (p) free_block{list.head};
+    if (++list.size <= max_cached)
+      return;
+
+    // keep the blocks that were freed last, they are hotter in the cache
+    constexpr auto kept = max_cached - batch_size;
+    auto last = list.head;
+    for (std::size_t i = 1; i < kept; ++i)
+      last = last->next;
+    get_depot().give(size_class,
+                     {std::exchange(last->next, nullptr), list.size - kept});
+    list.size = kept;
+  }
+};
+
+#if TCONCURRENT_USE_THREAD_LOCAL
+// trivially destructible, so it is still usable once the cache is destroyed
+thread_local bool cache_destroyed = false;
+
+struct thread_cache_holder
+{
+  thread_cache cache;
+
+  ~thread_cache_holder()
+  {
+    cache_destroyed = true;
+  }
+};
+
+thread_cache* local_cache()
+{
+  if (cache_destroyed)
+    return nullptr;
+  static thread_local thread_cache_holder holder;
+  return &holder.cache;
+}
+#else
+boost::thread_specific_ptr<thread_cache> tss_cache;
+
+thread_cache* local_cache()
+{
+  auto p = tss_cache.get();
+  if (!p)
+    tss_cache.reset(p = new thread_cache);
+  return p;
+}
+#endif
+}
+
+void* pool_allocate(std::size_t size)
+{
+  auto const size_class = size_class_of(size);
+  if (size_class == nb_size_classes)
+    return ::operator new(size);
+  if (auto const cache = local_cache())
+    return cache->allocate(size_class);
+  return ::operator new(size_classes[size_class]);
+}
+
+void pool_deallocate(void* p, std::size_t size) noexcept
+{
+  auto const size_class = size_class_of(size);
+  auto const cache = size_class < nb_size_classes ? local_cache() : nullptr;
+  if (cache)
+    cache->deallocate(p, size_class);
+  else
+    ::operator delete(p);
+}
+}
+}
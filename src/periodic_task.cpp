@@ -73,7 +73,7 @@ void periodic_task::reschedule()
   if (_state == State::Stopping)
     return;
 
-  _future = async_wait(_executor, _period)
+  _future = async_wait(_executor, _period, _slack)
                 .and_then(get_synchronous_executor(),
                           [this](cancelation_token& token, tvoid) {
                             return do_call(token);
@@ -0,0 +1,146 @@
+#include <tconcurrent/strand.hpp>
+
+#include <tconcurrent/detail/mpsc_queue.hpp>
+
+#include <atomic>
+#include <thread>
+
+#if !TCONCURRENT_USE_THREAD_LOCAL
+#include <boost/thread/tss.hpp>
+#endif
+
+namespace tconcurrent
+{
+namespace
+{
+#if TCONCURRENT_USE_THREAD_LOCAL
+void const*& current_strand()
+{
+  static thread_local void const* strand = nullptr;
+  return strand;
+}
+#else
+boost::thread_specific_ptr<void const*> strand;
+
+void const*& current_strand()
+{
+  auto p = strand.get();
+  if (!p)
+    strand.reset(p = new void const*(nullptr));
+  return *p;
+}
+#endif
+
+struct queued_task
+{
+  fu2::unique_function<void()> work;
+  task_name name;
+};
+}
+
+struct strand::state : std::enable_shared_from_this<state>
+{
+  executor underlying;
+  detail::mpsc_queue<queued_task> queue;
+  // Number of tasks posted and not run yet. The one who makes it go from 0 to
+  // 1 posts run() to the underlying executor.
+  std::atomic<std::size_t> pending{0};
+
+  explicit state(executor e) : underlying(std::move(e))
+  {
+  }
+
+  void schedule(task_name name)
+  {
+    underlying.post([self = shared_from_this()] { self->run(); }, name);
+  }
+
+  queued_task pop()
+  {
+    // pending tells there is a task, but its producer or one before it may not
+    // have linked it yet
+    while (true)
+    {
+      if (auto t = queue.try_pop())
+        return std::move(*t);
+      std::this_thread::yield();
+    }
+  }
+
+  void run()
+  {
+    auto& current = current_strand();
+    auto const previous = current;
+    current = this;
+    struct restore_guard
+    {
+      void const*& current;
+      void const* previous;
+      ~restore_guard()
+      {
+        current = previous;
+      }
+    } guard{current, previous};
+
+    for (std::size_t i = 0; i < tasks_per_run; ++i)
+    {
+      {
+        auto t = pop();
+        try
+        {
+          t.work();
+        }
+        catch (...)
+        {
+          underlying.signal_error(std::current_exception());
+        }
+      }
+      if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        return;
+    }
+    // there are more tasks, let the other tasks of the executor run first
+    schedule({});
+  }
+};
+
+strand::strand(executor e) : _state(std::make_shared<state>(std::move(e)))
+{
+}
+
+void strand::post(fu2::unique_function<void()> work, task_name name)
+{
+  _state->queue.push(queued_task{std::move(work), name});
+  if (_state->pending.fetch_add(1, std::memory_order_acq_rel) == 0)
+    _state->schedule(name);
+}
+
+boost::asio::io_context& strand::get_io_service()
+{
+  return _state->underlying.get_io_service();
+}
+
+bool strand::is_single_threaded() const
+{
+  return true;
+}
+
+bool strand::is_in_this_context() const
+{
+  return current_strand() == _state.get();
+}
+
+void strand::signal_error(std::exception_ptr const& e)
+{
+  _state->underlying.signal_error(e);
+}
+
+void strand::stop_before_fork()
+{
+  _state->underlying.stop_before_fork();
+}
+
+void strand::resume_after_fork()
+{
+  _state->underlying.resume_after_fork();
+}
+}
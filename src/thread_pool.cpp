@@ -1,36 +1,443 @@
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
 #include <iostream>
+#include <list>
+#include <mutex>
 #include <optional>
+#include <stdexcept>
+#include <string>
 
 #include <boost/thread/tss.hpp>
 
+#include <tconcurrent/blocking_region.hpp>
+#include <tconcurrent/detail/node_pool.hpp>
 #include <tconcurrent/detail/util.hpp>
+#include <tconcurrent/detail/work_stealing_deque.hpp>
 #include <tconcurrent/thread_pool.hpp>
 
 #include <boost/asio/bind_executor.hpp>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/post.hpp>
 
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
 namespace tconcurrent
 {
 
-struct thread_pool::impl
+namespace
+{
+struct task : detail::pooled
+{
+  fu2::unique_function<void()> work;
+  task_name name;
+  // only set in elastic mode or when latencies are recorded
+  std::chrono::steady_clock::time_point posted_at{};
+
+  task(fu2::unique_function<void()> work, task_name name)
+    : work(std::move(work)), name(name)
+  {
+  }
+};
+
+// A queued task of a lower priority class runs at least once every
+// starvation_limit tasks of the higher classes
+constexpr unsigned starvation_limit = 16;
+
+/// FIFO queues of tasks, one per priority class
+class run_queues
+{
+public:
+  run_queues() = default;
+  run_queues(run_queues const&) = delete;
+  run_queues& operator=(run_queues const&) = delete;
+
+  ~run_queues()
+  {
+    clear();
+  }
+
+  void push(std::unique_ptr<task> t, task_priority priority)
+  {
+    auto const index = static_cast<std::size_t>(priority);
+    std::lock_guard<std::mutex> _(_mutex);
+    _queues[index].push_back(t.get());
+    t.release();
+    ++_sizes[index];
+  }
+
+  void push(std::vector<std::unique_ptr<task>>& tasks, task_priority priority)
+  {
+    auto const index = static_cast<std::size_t>(priority);
+    std::lock_guard<std::mutex> _(_mutex);
+    for (auto& t : tasks)
+    {
+      _queues[index].push_back(t.get());
+      t.release();
+    }
+    _sizes[index] += tasks.size();
+  }
+
+  /** Pop the oldest task of the highest priority class, down to lowest
+   *
+   * A class that was passed over starvation_limit times while it had tasks
+   * goes first, whatever lowest is.
+   */
+  task* pop(task_priority lowest = task_priority::low)
+  {
+    auto const last = static_cast<std::size_t>(lowest);
+    std::size_t i = 0;
+    while (i <= last && !_sizes[i].load(std::memory_order_relaxed))
+      ++i;
+    if (i > last)
+      return nullptr;
+
+    std::lock_guard<std::mutex> _(_mutex);
+    auto chosen = nb_task_priorities;
+    for (std::size_t j = nb_task_priorities - 1; j > 0; --j)
+      if (!_queues[j].empty() && _skipped[j] >= starvation_limit)
+      {
+        chosen = j;
+        break;
+      }
+    if (chosen == nb_task_priorities)
+      for (std::size_t j = 0; j <= last; ++j)
+        if (!_queues[j].empty())
+        {
+          chosen = j;
+          break;
+        }
+    if (chosen == nb_task_priorities)
+      return nullptr;
+
+    for (auto j = chosen + 1; j < nb_task_priorities; ++j)
+      if (!_queues[j].empty())
+        ++_skipped[j];
+    _skipped[chosen] = 0;
+
+    auto const t = _queues[chosen].front();
+    _queues[chosen].pop_front();
+    --_sizes[chosen];
+    return t;
+  }
+
+  /// Number of queued tasks, it may be outdated as soon as it is returned
+  std::size_t size() const
+  {
+    std::size_t total = 0;
+    for (auto const& size : _sizes)
+      total += size.load(std::memory_order_relaxed);
+    return total;
+  }
+
+  void clear()
+  {
+    for (auto& queue : _queues)
+    {
+      for (auto const t : queue)
+        delete t;
+      queue.clear();
+    }
+    for (auto& size : _sizes)
+      size = 0;
+  }
+
+private:
+  std::mutex _mutex;
+  std::array<std::deque<task*>, nb_task_priorities> _queues;
+  std::array<std::atomic<std::size_t>, nb_task_priorities> _sizes{};
+  std::array<unsigned, nb_task_priorities> _skipped{};
+};
+
+struct worker
+{
+  void const* owner;
+  std::size_t index;
+  std::size_t domain;
+  // only holds normal priority tasks
+  detail::work_stealing_deque<task*> deque;
+  unsigned picks_since_shared_queues = 0;
+  // the other workers, those of our domain first
+  std::vector<worker*> victims;
+
+  worker(void const* owner, std::size_t index, std::size_t domain)
+    : owner(owner), index(index), domain(domain)
+  {
+  }
+};
+
+/// Asio handler whose operation is allocated from the node pool
+template <typename F>
+struct pool_allocated_handler
+{
+  using allocator_type = detail::pool_allocator<void>;
+
+  F f;
+
+  allocator_type get_allocator() const noexcept
+  {
+    return {};
+  }
+
+  void operator()()
+  {
+    f();
+  }
+};
+
+template <typename F>
+pool_allocated_handler<F> with_pool_allocator(F f)
+{
+  return {std::move(f)};
+}
+
+/// Metrics recorded by one thread, they are summed up in snapshots
+struct alignas(64) metrics_shard
+{
+  void const* owner;
+  std::atomic<std::uint64_t> posted{0};
+  std::atomic<std::uint64_t> executed{0};
+  std::atomic<std::uint64_t> stolen{0};
+  // only allocated when latencies are recorded
+  std::unique_ptr<detail::atomic_latency_histogram> queue_wait;
+  std::unique_ptr<detail::atomic_latency_histogram> run_time;
+
+  explicit metrics_shard(void const* owner) : owner(owner)
+  {
+  }
+};
+
+struct compensation_thread
+{
+  std::thread thread;
+  // set when the thread is about to return
+  bool done = false;
+};
+
+/// Parse the Linux cpulist format, e.g. "0-3,8-11"
+thread_pool::cpu_list parse_cpu_list(std::string const& str)
+{
+  thread_pool::cpu_list cpus;
+  std::size_t pos = 0;
+  while (pos < str.size())
+  {
+    auto const end = std::min(str.find(',', pos), str.size());
+    auto const range = str.substr(pos, end - pos);
+    auto const dash = range.find('-');
+    auto const first = std::stoul(range.substr(0, dash));
+    auto const last =
+        dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+    for (auto cpu = first; cpu <= last; ++cpu)
+      cpus.push_back(static_cast<unsigned int>(cpu));
+    pos = end + 1;
+  }
+  return cpus;
+}
+
+std::optional<thread_pool::cpu_list> read_cpu_list(std::string const& path)
+{
+  std::ifstream file(path);
+  std::string line;
+  if (!std::getline(file, line))
+    return std::nullopt;
+  line.erase(line.find_last_not_of(" \n") + 1);
+  return parse_cpu_list(line);
+}
+
+void pin_current_thread(thread_pool::cpu_list const& cpus)
+{
+  // start() checked the CPUs, there is nothing better to do than running
+  // unpinned if this fails anyway
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto const cpu : cpus)
+    CPU_SET(cpu, &set);
+  (void)pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#elif defined(_WIN32)
+  DWORD_PTR mask = 0;
+  for (auto const cpu : cpus)
+    mask |= DWORD_PTR(1) << cpu;
+  (void)SetThreadAffinityMask(GetCurrentThread(), mask);
+#else
+  (void)cpus;
+#endif
+}
+}
+
+struct thread_pool::impl final : detail::blocking_handler
 {
   using executor_type = boost::asio::io_context::executor_type;
   using work_guard = boost::asio::executor_work_guard<executor_type>;
 
+  // When all workers are busy, nobody is blocked in the io_context, so poll it
+  // every so often to run timers and I/O handlers
+  static constexpr unsigned io_poll_interval = 61;
+
   boost::asio::io_context _io;
   std::optional<work_guard> _work;
-  std::vector<std::thread> _threads;
   std::atomic<unsigned> _num_running_threads{0};
   std::atomic<bool> _dead{false};
 
+  thread_pool* _owner{nullptr};
+  start_config _config;
+  scheduling _scheduling{scheduling::shared_queue};
+  bool _elastic{false};
+  // set once a task is posted with a priority other than normal, until then
+  // the shared_queue mode posts the tasks directly to asio
+  std::atomic<bool> _priorities_used{false};
+
+  // One slot per thread the pool may run, the threads of the unused slots
+  // have exited or were never started. Slots are only used and released with
+  // _threads_mutex held, and the vector does not change while threads run.
+  std::mutex _threads_mutex;
+  std::vector<std::thread> _threads;
+  std::vector<bool> _used_slots;
+  std::atomic<unsigned> _num_threads{0};
+  bool _stopping{false};
+
+  // elastic mode state
+  std::chrono::steady_clock::time_point _last_grow{};
+  std::atomic<long> _num_pending{0};
+  std::atomic<std::chrono::steady_clock::rep> _last_dequeue{0};
+  std::thread _supervisor;
+  std::mutex _supervisor_mutex;
+  std::condition_variable _supervisor_cv;
+  bool _supervisor_stop{false};
+
+  // Compensation threads run while workers are in a blocking_region, there are
+  // never more active ones than blocked threads. The surplus ones park for
+  // idle_timeout to be reused, and then exit. They have no slot and no deque.
+  bool _compensate{false};
+  std::atomic<unsigned> _num_blocked{0};
+  std::atomic<unsigned> _num_compensating{0};
+  std::mutex _compensation_mutex;
+  std::condition_variable _compensation_cv;
+  std::list<compensation_thread> _compensation_threads;
+  unsigned _num_parked{0};
+  unsigned _unpark_tokens{0};
+  bool _stopping_compensation{false};
+
+  // In shared_queue mode, each asio handler runs the next task from the first
+  // one. In work_stealing mode, there is one per locality domain, they are the
+  // injection queues and they also hold the high and low priority tasks. This
+  // only grows when no thread is running.
+  std::vector<std::unique_ptr<run_queues>> _queues;
+  std::atomic<std::size_t> _next_domain{0};
+
+  // work_stealing state, one worker per thread slot, _workers is only modified
+  // when no thread is running
+  std::vector<std::unique_ptr<worker>> _workers;
+  std::atomic<unsigned> _num_idle{0};
+  std::atomic<bool> _canceled{false};
+
+  // The first shard is shared by the threads that have no slot, the others
+  // belong to one slot each. Shards are kept across restarts so that metrics
+  // accumulate, _metrics_mutex protects the vectors that get_metrics() walks
+  // when start() modifies them.
+  mutable std::mutex _metrics_mutex;
+  std::vector<std::unique_ptr<metrics_shard>> _metrics_shards;
+  bool _timestamp_tasks{false};
+
   // We need to be fork-safe, which means stopping all our threads before
   // a fork and restoring them after, so that they restart from a clean state
   std::atomic<unsigned> _num_threads_before_fork{0};
 
   error_handler_cb _error_cb{detail::default_error_cb};
   task_trace_handler_cb _task_trace_handler;
+
+  impl()
+  {
+    _queues.push_back(std::make_unique<run_queues>());
+    _metrics_shards.push_back(std::make_unique<metrics_shard>(this));
+  }
+
+  ~impl()
+  {
+    // discard the tasks that were never run while the io_context is still
+    // alive, in case they post something on destruction
+    for (auto const& w : _workers)
+    {
+      task* t;
+      while (w->deque.pop(t))
+        delete t;
+    }
+    for (auto const& queues : _queues)
+      queues->clear();
+  }
+
+  void run_task(fu2::unique_function<void()>& work, task_name name)
+  {
+    if (_task_trace_handler)
+    {
+      auto const before = std::chrono::steady_clock::now();
+      work();
+      auto const ellapsed = std::chrono::steady_clock::now() - before;
+      _task_trace_handler(name.to_string(), ellapsed);
+    }
+    else
+    {
+      work();
+    }
+  }
+
+  void signal_error(std::exception_ptr const& e)
+  {
+    try
+    {
+      _error_cb(e);
+    }
+    catch (...)
+    {
+      std::cerr << "exception thrown in error handler" << std::endl;
+      assert(false && "exception thrown in error handler");
+    }
+  }
+
+  void enter_blocking() override;
+  void leave_blocking() override;
+
+  void run(std::optional<std::size_t> slot, bool compensating = false);
+  void run_slot(std::size_t slot);
+  void run_io(std::optional<std::size_t> slot, bool compensating);
+  void post(std::unique_ptr<task> t,
+            task_priority priority,
+            std::optional<std::size_t> domain);
+  void run_queued(std::size_t nb_tasks);
+  void run_work_stealing(worker* self,
+                         std::optional<std::size_t> slot,
+                         bool compensating);
+  void run_dequeued(task* t);
+  void post_work_stealing(std::unique_ptr<task> t,
+                          task_priority priority,
+                          std::optional<std::size_t> domain);
+  void post_bulk_work_stealing(std::vector<fu2::unique_function<void()>> works,
+                               task_name name);
+  void wake_up(std::size_t nb_tasks);
+  task* next_task(worker* self);
+  void spawn(std::size_t slot);
+  void grow();
+  bool try_retire(std::size_t slot);
+  void on_posted(std::size_t nb_tasks);
+  void supervise();
+  void stop_supervisor();
+  void run_compensation(std::list<compensation_thread>::iterator self);
+  bool try_stop_compensating();
+  bool park_compensation();
+  void stop_compensation();
+  task* pop_queued(std::size_t home, task_priority lowest);
+  worker* current_worker_of_this_pool() const;
+  metrics_shard& current_metrics_shard() const;
+  void timestamp(task& t) const;
+  std::size_t next_domain();
 };
 
 namespace detail
@@ -47,6 +454,8 @@ namespace
 {
 #if TCONCURRENT_USE_THREAD_LOCAL
 thread_local void* current_executor;
+thread_local void* current_worker;
+thread_local void* current_shard;
 #define SET_THREAD_LOCAL(tl, val) tl = val
 #define GET_THREAD_LOCAL(tl) tl
 #else
@@ -54,11 +463,558 @@ void noopdelete(void*)
 {
 }
 boost::thread_specific_ptr<void> current_executor(noopdelete);
+boost::thread_specific_ptr<void> current_worker(noopdelete);
+boost::thread_specific_ptr<void> current_shard(noopdelete);
 #define SET_THREAD_LOCAL(tl, val) tl.reset(val)
 #define GET_THREAD_LOCAL(tl) tl.get()
 #endif
 }
 
+void thread_pool::impl::run(std::optional<std::size_t> slot,
+                            bool compensating)
+{
+  SET_THREAD_LOCAL(current_executor, _owner);
+  SET_THREAD_LOCAL(current_shard,
+                   _metrics_shards[slot ? *slot + 1 : 0].get());
+  auto& blocking_handler = detail::current_blocking_handler();
+  auto const previous_handler = blocking_handler;
+  blocking_handler = _compensate ? this : nullptr;
+  ++_num_running_threads;
+  if (_scheduling == scheduling::work_stealing)
+  {
+    // threads that were not spawned by start() help without a deque
+    run_work_stealing(current_worker_of_this_pool(), slot, compensating);
+  }
+  else
+    run_io(slot, compensating);
+  blocking_handler = previous_handler;
+  SET_THREAD_LOCAL(current_shard, nullptr);
+  SET_THREAD_LOCAL(current_executor, nullptr);
+  --_num_running_threads;
+}
+
+void thread_pool::impl::run_slot(std::size_t slot)
+{
+  auto const& placement = _config.placement;
+  if (!placement.empty())
+    pin_current_thread(placement[slot % placement.size()]);
+  if (_scheduling == scheduling::work_stealing)
+    SET_THREAD_LOCAL(current_worker, _workers[slot].get());
+  run(slot);
+  SET_THREAD_LOCAL(current_worker, nullptr);
+}
+
+void thread_pool::impl::run_io(std::optional<std::size_t> slot,
+                               bool compensating)
+{
+  auto const can_retire = _elastic && slot;
+  while (true)
+  {
+    try
+    {
+      if (!can_retire && !compensating)
+      {
+        _io.run();
+        break;
+      }
+      // run_one_for() returns 0 when the io_context is stopped, or when we
+      // were idle for idle_timeout
+      auto const ran = _io.run_one_for(_config.idle_timeout);
+      if (ran == 0 && _io.stopped())
+        break;
+      if (compensating ? try_stop_compensating()
+                       : ran == 0 && try_retire(*slot))
+        break;
+    }
+    catch (...)
+    {
+      signal_error(std::current_exception());
+    }
+  }
+}
+
+void thread_pool::impl::run_queued(std::size_t nb_tasks)
+{
+  // a handler may run tasks of a higher priority that were posted after its
+  // own, or find that other handlers already ran them
+  for (std::size_t i = 0; i < nb_tasks; ++i)
+  {
+    auto const t = _queues.front()->pop();
+    if (!t)
+      return;
+    try
+    {
+      run_dequeued(t);
+    }
+    catch (...)
+    {
+      signal_error(std::current_exception());
+    }
+  }
+}
+
+void thread_pool::impl::run_dequeued(task* t)
+{
+  std::unique_ptr<task> holder(t);
+  using clock = std::chrono::steady_clock;
+  auto const started = _timestamp_tasks ? clock::now() : clock::time_point{};
+  if (_elastic)
+  {
+    --_num_pending;
+    _last_dequeue.store(started.time_since_epoch().count(),
+                        std::memory_order_relaxed);
+    if (started - t->posted_at > _config.grow_latency)
+      grow();
+  }
+
+  auto& shard = current_metrics_shard();
+  if (!shard.run_time)
+  {
+    shard.executed.fetch_add(1, std::memory_order_relaxed);
+    run_task(t->work, t->name);
+    return;
+  }
+
+  shard.queue_wait->record(started - t->posted_at);
+  shard.executed.fetch_add(1, std::memory_order_relaxed);
+  try
+  {
+    run_task(t->work, t->name);
+  }
+  catch (...)
+  {
+    shard.run_time->record(clock::now() - started);
+    throw;
+  }
+  shard.run_time->record(clock::now() - started);
+}
+
+void thread_pool::impl::run_work_stealing(worker* self,
+                                          std::optional<std::size_t> slot,
+                                          bool compensating)
+{
+  auto const can_retire = _elastic && slot;
+  unsigned since_last_poll = 0;
+  while (true)
+  {
+    try
+    {
+      if (_canceled.load(std::memory_order_relaxed))
+        break;
+      if (compensating && try_stop_compensating())
+        break;
+
+      if (++since_last_poll == io_poll_interval)
+      {
+        since_last_poll = 0;
+        _io.poll();
+      }
+
+      if (auto const t = next_task(self))
+      {
+        run_dequeued(t);
+        continue;
+      }
+
+      // Advertise that we are going to sleep before checking the queues one
+      // last time, post_work_stealing() does the opposite so that at least one
+      // of us sees the other.
+      _num_idle.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (auto const t = next_task(self))
+      {
+        --_num_idle;
+        run_dequeued(t);
+        continue;
+      }
+
+      since_last_poll = 0;
+      // Sleep until a timer or an I/O event fires, or until someone posts a
+      // wake-up handler. run_one() returns 0 when the io_context is stopped,
+      // which happens once the work guard is gone and there is no more
+      // pending asio work. run_one_for() also returns 0 when we were idle
+      // for idle_timeout.
+      auto const ran = can_retire || compensating
+                           ? _io.run_one_for(_config.idle_timeout)
+                           : _io.run_one();
+      --_num_idle;
+      if (ran == 0 && _io.stopped())
+      {
+        // drain what's left before leaving
+        while (auto const t = next_task(self))
+          run_dequeued(t);
+        break;
+      }
+      // Only we push to our deque, and it was empty, so we can leave. Tasks
+      // queued in the meantime are left to the other threads, that are
+      // either busy or were sent a wake-up handler.
+      if (ran == 0 && can_retire && try_retire(*slot))
+        break;
+    }
+    catch (...)
+    {
+      signal_error(std::current_exception());
+    }
+  }
+}
+
+task* thread_pool::impl::next_task(worker* self)
+{
+  auto const home = self ? self->domain : 0;
+
+  task* t;
+  if ((t = pop_queued(home, task_priority::high)))
+    return t;
+
+  // Look at the shared queues every so often, even when we have local work,
+  // so that the tasks there do not starve
+  if (self && ++self->picks_since_shared_queues >= starvation_limit)
+  {
+    self->picks_since_shared_queues = 0;
+    if ((t = pop_queued(home, task_priority::low)))
+      return t;
+  }
+
+  if (self && self->deque.pop(t))
+    return t;
+
+  if ((t = pop_queued(home, task_priority::normal)))
+    return t;
+
+  if (self)
+  {
+    for (auto const victim : self->victims)
+      if (victim->deque.steal(t))
+      {
+        current_metrics_shard().stolen.fetch_add(1, std::memory_order_relaxed);
+        return t;
+      }
+  }
+  else
+  {
+    for (auto const& victim : _workers)
+      if (victim->deque.steal(t))
+      {
+        current_metrics_shard().stolen.fetch_add(1, std::memory_order_relaxed);
+        return t;
+      }
+  }
+  return pop_queued(home, task_priority::low);
+}
+
+task* thread_pool::impl::pop_queued(std::size_t home, task_priority lowest)
+{
+  // the queue of our own domain goes first
+  auto const size = _queues.size();
+  for (std::size_t i = 0; i < size; ++i)
+    if (auto const t = _queues[(home + i) % size]->pop(lowest))
+      return t;
+  return nullptr;
+}
+
+worker* thread_pool::impl::current_worker_of_this_pool() const
+{
+  auto const self = static_cast<worker*>(GET_THREAD_LOCAL(current_worker));
+  // the current thread may be a worker of another pool
+  return self && self->owner == this ? self : nullptr;
+}
+
+metrics_shard& thread_pool::impl::current_metrics_shard() const
+{
+  auto const shard =
+      static_cast<metrics_shard*>(GET_THREAD_LOCAL(current_shard));
+  // threads that are not ours record in the shared shard
+  return shard && shard->owner == this ? *shard : *_metrics_shards.front();
+}
+
+void thread_pool::impl::timestamp(task& t) const
+{
+  if (_timestamp_tasks)
+    t.posted_at = std::chrono::steady_clock::now();
+}
+
+std::size_t thread_pool::impl::next_domain()
+{
+  // spread the tasks that come from outside the pool
+  auto const size = _queues.size();
+  if (size == 1)
+    return 0;
+  return _next_domain.fetch_add(1, std::memory_order_relaxed) % size;
+}
+
+void thread_pool::impl::post(std::unique_ptr<task> t,
+                             task_priority priority,
+                             std::optional<std::size_t> domain)
+{
+  assert(!_dead.load());
+  current_metrics_shard().posted.fetch_add(1, std::memory_order_relaxed);
+  timestamp(*t);
+  if (_elastic)
+    on_posted(1);
+  if (_scheduling == scheduling::work_stealing)
+  {
+    post_work_stealing(std::move(t), priority, domain);
+    return;
+  }
+
+  if (priority != task_priority::normal &&
+      !_priorities_used.load(std::memory_order_relaxed))
+    _priorities_used.store(true, std::memory_order_relaxed);
+  if (!_priorities_used.load(std::memory_order_relaxed))
+  {
+    // all the tasks have the same priority, asio's FIFO is enough
+    boost::asio::post(boost::asio::bind_executor(
+        _io.get_executor(),
+        with_pool_allocator([this, t = std::move(t)]() mutable {
+          try
+          {
+            run_dequeued(t.release());
+          }
+          catch (...)
+          {
+            signal_error(std::current_exception());
+          }
+        })));
+    return;
+  }
+
+  // asio runs its handlers in FIFO order, so it only gets a handler that runs
+  // the next task from the priority queues
+  _queues.front()->push(std::move(t), priority);
+  boost::asio::post(boost::asio::bind_executor(
+      _io.get_executor(), with_pool_allocator([this] { run_queued(1); })));
+}
+
+void thread_pool::impl::post_work_stealing(std::unique_ptr<task> t,
+                                           task_priority priority,
+                                           std::optional<std::size_t> domain)
+{
+  auto const self = current_worker_of_this_pool();
+  // without a hint, tasks posted from a worker stay in its domain
+  if (!domain && self)
+    domain = self->domain;
+  if (priority == task_priority::normal && self && *domain == self->domain)
+    self->deque.push(t.release());
+  else
+    _queues[domain ? *domain % _queues.size() : next_domain()]->push(
+        std::move(t), priority);
+
+  wake_up(1);
+}
+
+void thread_pool::impl::post_bulk_work_stealing(
+    std::vector<fu2::unique_function<void()>> works, task_name name)
+{
+  std::vector<std::unique_ptr<task>> tasks;
+  tasks.reserve(works.size());
+  for (auto& work : works)
+    tasks.push_back(std::make_unique<task>(std::move(work), name));
+  current_metrics_shard().posted.fetch_add(tasks.size(),
+                                           std::memory_order_relaxed);
+  if (_timestamp_tasks)
+  {
+    auto const now = std::chrono::steady_clock::now();
+    for (auto& t : tasks)
+      t->posted_at = now;
+  }
+  if (_elastic)
+    on_posted(tasks.size());
+
+  if (auto const self = current_worker_of_this_pool())
+  {
+    for (auto& t : tasks)
+      self->deque.push(t.release());
+  }
+  else
+    _queues[next_domain()]->push(tasks, task_priority::normal);
+
+  wake_up(tasks.size());
+}
+
+void thread_pool::impl::spawn(std::size_t slot)
+{
+  // _threads_mutex must be locked
+
+  // the previous thread of this slot has retired, but it may still be
+  // returning
+  if (_threads[slot].joinable())
+    _threads[slot].join();
+  _used_slots[slot] = true;
+  ++_num_threads;
+  _threads[slot] = std::thread([this, slot] { run_slot(slot); });
+}
+
+void thread_pool::impl::grow()
+{
+  // someone else is already spawning or retiring a thread
+  std::unique_lock<std::mutex> lock(_threads_mutex, std::try_to_lock);
+  if (!lock.owns_lock() || _stopping || _num_threads.load() >= _threads.size())
+    return;
+
+  auto const now = std::chrono::steady_clock::now();
+  if (now - _last_grow < _config.grow_latency)
+    return;
+  _last_grow = now;
+
+  auto const slot = static_cast<std::size_t>(
+      std::find(_used_slots.begin(), _used_slots.end(), false) -
+      _used_slots.begin());
+  spawn(slot);
+}
+
+bool thread_pool::impl::try_retire(std::size_t slot)
+{
+  std::lock_guard<std::mutex> _(_threads_mutex);
+  if (_stopping || _num_threads.load() <= _config.thread_count)
+    return false;
+  --_num_threads;
+  _used_slots[slot] = false;
+  return true;
+}
+
+void thread_pool::impl::on_posted(std::size_t nb_tasks)
+{
+  if (_num_pending.fetch_add(static_cast<long>(nb_tasks)) <= 0)
+  {
+    // the supervisor checks _num_pending with the mutex locked before going to
+    // sleep
+    std::lock_guard<std::mutex> _(_supervisor_mutex);
+    _supervisor_cv.notify_one();
+  }
+}
+
+void thread_pool::impl::supervise()
+{
+  // This thread catches the cases where tasks are queued but no thread picks
+  // them. It only wakes up periodically when there are queued tasks.
+  std::unique_lock<std::mutex> lock(_supervisor_mutex);
+  while (!_supervisor_stop)
+  {
+    if (_num_pending.load() <= 0)
+    {
+      _supervisor_cv.wait(lock);
+      continue;
+    }
+
+    _supervisor_cv.wait_for(lock, _config.grow_latency);
+    using clock = std::chrono::steady_clock;
+    auto const last_dequeue = clock::time_point(
+        clock::duration(_last_dequeue.load(std::memory_order_relaxed)));
+    if (!_supervisor_stop && _num_pending.load() > 0 &&
+        clock::now() - last_dequeue > _config.grow_latency)
+      grow();
+  }
+}
+
+void thread_pool::impl::stop_supervisor()
+{
+  if (!_supervisor.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> _(_supervisor_mutex);
+    _supervisor_stop = true;
+  }
+  _supervisor_cv.notify_one();
+  _supervisor.join();
+  _supervisor_stop = false;
+}
+
+void thread_pool::impl::enter_blocking()
+{
+  std::lock_guard<std::mutex> _(_compensation_mutex);
+  auto const blocked = ++_num_blocked;
+  if (_stopping_compensation || _num_compensating.load() >= blocked)
+    return;
+
+  if (_num_parked > _unpark_tokens)
+  {
+    ++_num_compensating;
+    ++_unpark_tokens;
+    _compensation_cv.notify_one();
+    return;
+  }
+
+  for (auto it = _compensation_threads.begin();
+       it != _compensation_threads.end();)
+  {
+    if (it->done)
+    {
+      it->thread.join();
+      it = _compensation_threads.erase(it);
+    }
+    else
+      ++it;
+  }
+  if (_compensation_threads.size() >= _config.max_compensation_threads)
+    return;
+
+  ++_num_compensating;
+  auto const it = _compensation_threads.emplace(_compensation_threads.end());
+  it->thread = std::thread([this, it] { run_compensation(it); });
+}
+
+void thread_pool::impl::leave_blocking()
+{
+  // the compensation threads notice it between two tasks
+  --_num_blocked;
+}
+
+void thread_pool::impl::run_compensation(
+    std::list<compensation_thread>::iterator self)
+{
+  do
+    run(std::nullopt, true);
+  while (park_compensation());
+
+  std::lock_guard<std::mutex> _(_compensation_mutex);
+  self->done = true;
+}
+
+bool thread_pool::impl::try_stop_compensating()
+{
+  auto compensating = _num_compensating.load();
+  while (compensating > _num_blocked.load())
+    if (_num_compensating.compare_exchange_weak(compensating,
+                                                compensating - 1))
+      return true;
+  return false;
+}
+
+bool thread_pool::impl::park_compensation()
+{
+  std::unique_lock<std::mutex> lock(_compensation_mutex);
+  ++_num_parked;
+  auto const unparked =
+      _compensation_cv.wait_for(lock, _config.idle_timeout, [&] {
+        return _unpark_tokens > 0 || _stopping_compensation;
+      });
+  --_num_parked;
+  if (!unparked || _stopping_compensation)
+    return false;
+  --_unpark_tokens;
+  return true;
+}
+
+void thread_pool::impl::stop_compensation()
+{
+  {
+    std::lock_guard<std::mutex> _(_compensation_mutex);
+    _stopping_compensation = true;
+  }
+  _compensation_cv.notify_all();
+}
+
+void thread_pool::impl::wake_up(std::size_t nb_tasks)
+{
+  // pairs with the fence in run_work_stealing()
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto const idle = std::min<std::size_t>(
+      nb_tasks, _num_idle.load(std::memory_order_relaxed));
+  // each handler wakes up one thread blocked in run_one()
+  for (std::size_t i = 0; i < idle; ++i)
+    boost::asio::post(_io, with_pool_allocator([] {}));
+}
+
 thread_pool::thread_pool() : _p(new impl)
 {
 }
@@ -79,57 +1035,253 @@ bool thread_pool::is_single_threaded() const
   return _p->_threads.size() == 1;
 }
 
+unsigned int thread_pool::thread_count() const
+{
+  return _p->_num_threads.load();
+}
+
 boost::asio::io_context& thread_pool::get_io_service()
 {
   return _p->_io;
 }
 
-void thread_pool::start(unsigned int thread_count)
+thread_pool::metrics thread_pool::get_metrics() const
 {
-  if (_p->_work)
-    throw std::runtime_error("the threadpool is already running");
+  metrics m;
+  std::lock_guard<std::mutex> _(_p->_metrics_mutex);
+  for (auto const& shard : _p->_metrics_shards)
+  {
+    m.tasks_posted += shard->posted.load(std::memory_order_relaxed);
+    m.tasks_executed += shard->executed.load(std::memory_order_relaxed);
+    m.tasks_stolen += shard->stolen.load(std::memory_order_relaxed);
+    if (shard->run_time)
+    {
+      shard->queue_wait->snapshot_into(m.queue_wait);
+      shard->run_time->snapshot_into(m.run_time);
+    }
+  }
+  if (_p->_scheduling == scheduling::shared_queue)
+  {
+    // tasks may wait in asio's queue instead of ours, see impl::post()
+    m.queue_depth = m.tasks_posted > m.tasks_executed
+                        ? m.tasks_posted - m.tasks_executed
+                        : 0;
+    return m;
+  }
+  for (auto const& queues : _p->_queues)
+    m.queue_depth += queues->size();
+  for (auto const& w : _p->_workers)
+    m.queue_depth += w->deque.size();
+  return m;
+}
 
-  _p->_work.emplace(boost::asio::make_work_guard(_p->_io.get_executor()));
-  for (unsigned int i = 0; i < thread_count; ++i)
-    _p->_threads.emplace_back([this] { run_thread(); });
+unsigned int thread_pool::domain_count() const
+{
+  return std::max<unsigned int>(1, _p->_config.placement.size());
 }
 
-void thread_pool::run_thread()
+std::optional<thread_pool::locality> thread_pool::current_locality() const
 {
-  SET_THREAD_LOCAL(current_executor, this);
-  ++_p->_num_running_threads;
-  while (true)
+  if (auto const self = _p->current_worker_of_this_pool())
+    return locality{static_cast<unsigned int>(self->domain)};
+  return std::nullopt;
+}
+
+thread_pool::cpu_list thread_pool::available_cpus()
+{
+  cpu_list cpus;
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    for (unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      if (CPU_ISSET(cpu, &set))
+        cpus.push_back(cpu);
+#elif defined(_WIN32)
+  DWORD_PTR process_mask;
+  DWORD_PTR system_mask;
+  if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask))
+    for (unsigned int cpu = 0; cpu < sizeof(DWORD_PTR) * 8; ++cpu)
+      if (process_mask & (DWORD_PTR(1) << cpu))
+        cpus.push_back(cpu);
+#endif
+  return cpus;
+}
+
+std::vector<thread_pool::cpu_list> thread_pool::numa_nodes()
+{
+  auto const available = available_cpus();
+  if (available.empty())
+    return {};
+
+  std::vector<cpu_list> nodes;
+#if defined(__linux__)
+  if (auto const online = read_cpu_list("/sys/devices/system/node/online"))
   {
-    try
+    for (auto const node : *online)
     {
-      _p->_io.run();
-      SET_THREAD_LOCAL(current_executor, nullptr);
-      break;
+      auto const cpus = read_cpu_list("/sys/devices/system/node/node" +
+                                      std::to_string(node) + "/cpulist");
+      if (!cpus)
+        continue;
+      cpu_list node_cpus;
+      for (auto const cpu : *cpus)
+        if (std::find(available.begin(), available.end(), cpu) !=
+            available.end())
+          node_cpus.push_back(cpu);
+      if (!node_cpus.empty())
+        nodes.push_back(std::move(node_cpus));
     }
-    catch (...)
+  }
+#endif
+  if (nodes.empty())
+    nodes.push_back(available);
+  return nodes;
+}
+
+void thread_pool::start(unsigned int thread_count, scheduling sched)
+{
+  start(start_config{thread_count, sched, {}});
+}
+
+void thread_pool::start(start_config config)
+{
+  if (_p->_work)
+    throw std::runtime_error("the threadpool is already running");
+
+  if (!config.placement.empty())
+  {
+    auto const available = available_cpus();
+    for (auto const& cpus : config.placement)
     {
-      try
-      {
-        _p->_error_cb(std::current_exception());
-      }
-      catch (...)
+      if (cpus.empty())
+        throw std::invalid_argument("thread_pool placement has no CPU");
+      for (auto const cpu : cpus)
+        if (std::find(available.begin(), available.end(), cpu) ==
+            available.end())
+          throw std::invalid_argument("CPU " + std::to_string(cpu) +
+                                      " is not available");
+    }
+  }
+
+  auto const elastic = config.max_thread_count > config.thread_count;
+  if (elastic && config.thread_count == 0)
+    throw std::invalid_argument(
+        "an elastic thread_pool needs at least one thread to run its timers");
+
+  auto const nb_slots =
+      elastic ? config.max_thread_count : config.thread_count;
+  auto const nb_domains = std::max<std::size_t>(1, config.placement.size());
+
+  _p->_owner = this;
+  _p->_config = std::move(config);
+  _p->_scheduling = _p->_config.sched;
+  _p->_elastic = elastic;
+  // tasks of a single-threaded pool must not run concurrently
+  _p->_compensate = nb_slots > 1 && _p->_config.max_compensation_threads > 0;
+  _p->_timestamp_tasks = elastic || _p->_config.record_latencies;
+  _p->_num_pending = 0;
+  _p->_last_dequeue =
+      std::chrono::steady_clock::now().time_since_epoch().count();
+
+  std::unique_lock<std::mutex> metrics_lock(_p->_metrics_mutex);
+  while (_p->_metrics_shards.size() < nb_slots + 1)
+    _p->_metrics_shards.push_back(std::make_unique<metrics_shard>(_p.get()));
+  if (_p->_config.record_latencies)
+    for (auto const& shard : _p->_metrics_shards)
+      if (!shard->run_time)
       {
-        std::cerr << "exception thrown in error handler" << std::endl;
-        assert(false && "exception thrown in error handler");
+        using histogram = detail::atomic_latency_histogram;
+        shard->queue_wait = std::make_unique<histogram>();
+        shard->run_time = std::make_unique<histogram>();
       }
+  while (_p->_queues.size() < nb_domains)
+    _p->_queues.push_back(std::make_unique<run_queues>());
+  _p->_work.emplace(boost::asio::make_work_guard(_p->_io.get_executor()));
+  if (_p->_scheduling == scheduling::work_stealing)
+  {
+    // a previous run may have left its workers behind
+    for (auto const& w : _p->_workers)
+    {
+      task* t;
+      while (w->deque.pop(t))
+        delete t;
+    }
+    _p->_workers.clear();
+
+    for (unsigned int i = 0; i < nb_slots; ++i)
+      _p->_workers.push_back(
+          std::make_unique<worker>(_p.get(), i, i % nb_domains));
+    // Start stealing after ourselves so that thieves do not all hammer the
+    // first worker, and steal in our own domain first
+    for (auto const& w : _p->_workers)
+    {
+      for (auto const same_domain : {true, false})
+        for (unsigned int i = 1; i < nb_slots; ++i)
+        {
+          auto const victim = _p->_workers[(w->index + i) % nb_slots].get();
+          if ((victim->domain == w->domain) == same_domain)
+            w->victims.push_back(victim);
+        }
     }
   }
-  --_p->_num_running_threads;
+  metrics_lock.unlock();
+
+  std::lock_guard<std::mutex> _(_p->_threads_mutex);
+  _p->_threads.resize(nb_slots);
+  _p->_used_slots.assign(nb_slots, false);
+  for (unsigned int i = 0; i < _p->_config.thread_count; ++i)
+    _p->spawn(i);
+  if (elastic)
+    _p->_supervisor = std::thread([p = _p.get()] { p->supervise(); });
+}
+
+void thread_pool::run_thread()
+{
+  _p->run(std::nullopt);
 }
 
 void thread_pool::stop(bool cancel_work)
 {
+  // no more threads are spawned or retired from now on
+  {
+    std::lock_guard<std::mutex> _(_p->_threads_mutex);
+    _p->_stopping = true;
+  }
+  _p->stop_supervisor();
+  _p->stop_compensation();
+
   _p->_work = std::nullopt;
   if (cancel_work)
+  {
+    _p->_canceled = true;
     _p->_io.stop();
+  }
   for (auto& th : _p->_threads)
-    th.join();
-  _p->_threads.clear();
+    if (th.joinable())
+      th.join();
+  // the active compensation threads exit with the workers, the parked ones
+  // were woken up
+  std::list<compensation_thread> compensation_threads;
+  {
+    std::lock_guard<std::mutex> _(_p->_compensation_mutex);
+    compensation_threads.swap(_p->_compensation_threads);
+  }
+  for (auto& c : compensation_threads)
+    c.thread.join();
+  {
+    std::lock_guard<std::mutex> _(_p->_threads_mutex);
+    _p->_threads.clear();
+    _p->_used_slots.clear();
+    _p->_num_threads = 0;
+    _p->_stopping = false;
+  }
+  {
+    std::lock_guard<std::mutex> _(_p->_compensation_mutex);
+    _p->_num_compensating = 0;
+    _p->_unpark_tokens = 0;
+    _p->_stopping_compensation = false;
+  }
 
   // It is very important to at least terminate all threads we started because
   // otherwise a dlclose() call may unmap the library making the lonely thread
@@ -169,6 +1321,9 @@ void thread_pool::resume_after_fork()
     return;
 
   unsigned num_threads = _p->_num_threads_before_fork.load();
+  auto config = std::move(_p->_config);
+  if (config.max_thread_count <= config.thread_count)
+    config.thread_count = num_threads;
 
   auto error_cb = std::move(_p->_error_cb);
   auto task_trace_handler_cb = std::move(_p->_task_trace_handler);
@@ -177,7 +1332,7 @@ void thread_pool::resume_after_fork()
   _p.reset(new impl);
   _p->_error_cb = std::move(error_cb);
   _p->_task_trace_handler = std::move(task_trace_handler_cb);
-  this->start(num_threads);
+  this->start(std::move(config));
 }
 
 bool thread_pool::is_running() const
@@ -201,23 +1356,72 @@ void thread_pool::set_task_trace_handler(task_trace_handler_cb cb)
   _p->_task_trace_handler = std::move(cb);
 }
 
-void thread_pool::post(fu2::unique_function<void()> work, std::string name)
+void thread_pool::post(fu2::unique_function<void()> work, task_name name)
+{
+  post(std::move(work), task_priority::normal, name);
+}
+
+void thread_pool::post(fu2::unique_function<void()> work,
+                       task_priority priority,
+                       task_name name)
+{
+  _p->post(std::make_unique<task>(std::move(work), name),
+           priority,
+           std::nullopt);
+}
+
+void thread_pool::post(fu2::unique_function<void()> work,
+                       locality where,
+                       task_priority priority,
+                       task_name name)
+{
+  assert(where.domain < domain_count());
+  _p->post(std::make_unique<task>(std::move(work), name),
+           priority,
+           where.domain);
+}
+
+void thread_pool::post_bulk(std::vector<fu2::unique_function<void()>> works,
+                            task_name name)
 {
   assert(!_p->_dead.load());
-  boost::asio::post(boost::asio::bind_executor(
-      _p->_io.get_executor(),
-      [this, work = std::move(work), name = std::move(name)]() mutable {
-        if (_p->_task_trace_handler)
-        {
-          auto const before = std::chrono::steady_clock::now();
-          work();
-          auto const ellapsed = std::chrono::steady_clock::now() - before;
-          _p->_task_trace_handler(name, ellapsed);
-        }
-        else
-        {
-          work();
-        }
-      }));
+  if (works.empty())
+    return;
+
+  if (_p->_scheduling == scheduling::work_stealing)
+  {
+    _p->post_bulk_work_stealing(std::move(works), name);
+    return;
+  }
+
+  // asio has no batch post, so queue all the tasks at once and post one
+  // handler per thread. Each handler runs tasks until the queue is empty, so
+  // that a slow task does not hold back the ones behind it, and the handlers
+  // that come too late exit.
+  std::vector<std::unique_ptr<task>> tasks;
+  tasks.reserve(works.size());
+  for (auto& work : works)
+    tasks.push_back(std::make_unique<task>(std::move(work), name));
+  _p->current_metrics_shard().posted.fetch_add(tasks.size(),
+                                               std::memory_order_relaxed);
+  if (_p->_timestamp_tasks)
+  {
+    auto const now = std::chrono::steady_clock::now();
+    for (auto& t : tasks)
+      t->posted_at = now;
+  }
+  if (_p->_elastic)
+    _p->on_posted(tasks.size());
+  _p->_queues.front()->push(tasks, task_priority::normal);
+
+  // a handler never runs more tasks than the batch, to let other asio
+  // handlers run if the queue keeps being filled
+  auto const nb_tasks = works.size();
+  auto const nb_handlers = std::max<std::size_t>(
+      1, std::min<std::size_t>(nb_tasks, _p->_threads.size()));
+  for (std::size_t i = 0; i < nb_handlers; ++i)
+    boost::asio::post(boost::asio::bind_executor(
+        _p->_io.get_executor(),
+        with_pool_allocator([this, nb_tasks] { _p->run_queued(nb_tasks); })));
 }
 }
@@ -0,0 +1,357 @@
+#include <tconcurrent/detail/timer_wheel.hpp>
+
+#include <boost/asio/steady_timer.hpp>
+
+#include <array>
+#include <cassert>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace tconcurrent
+{
+namespace detail
+{
+namespace
+{
+constexpr unsigned level_bits = 6;
+constexpr unsigned slots_per_level = 1u << level_bits;
+// 64^6 ticks is more than two years, timers that are further away wait in the
+// far bucket
+constexpr unsigned nb_levels = 6;
+
+constexpr std::size_t due_bucket = nb_levels * slots_per_level;
+constexpr std::size_t far_bucket = due_bucket + 1;
+constexpr std::size_t nb_buckets = far_bucket + 1;
+
+unsigned lowest_bit(std::uint64_t v)
+{
+  assert(v);
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index, v);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctzll(v));
+#endif
+}
+
+unsigned highest_bit(std::uint64_t v)
+{
+  assert(v);
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanReverse64(&index, v);
+  return static_cast<unsigned>(index);
+#else
+  return 63 - static_cast<unsigned>(__builtin_clzll(v));
+#endif
+}
+
+// The number in [first, last] that has the most trailing zero bits
+std::uint64_t coarsest_tick(std::uint64_t first, std::uint64_t last)
+{
+  if (first == 0 || first >= last)
+    return first;
+  // first - 1 and last agree on the bits above the highest one that differs,
+  // clearing the bits under it gives a number greater than first - 1
+  auto const bit = highest_bit((first - 1) ^ last);
+  return last & ~((std::uint64_t{1} << bit) - 1);
+}
+
+struct event
+{
+  std::uint64_t time;
+  std::size_t bucket;
+};
+}
+
+boost::asio::io_context::id timer_wheel::id;
+
+/* Invariants:
+ * - every tick up to current has been processed
+ * - a timer is in the due bucket if it expires at or before current
+ * - otherwise it is in the lowest level l where its expiry and current are in
+ *   the same block of 64^(l+1) ticks, in the slot that comes strictly after
+ *   the one of current on that level
+ * - otherwise it is in the far bucket
+ *
+ * So the lower levels always have the earlier slots, and the next slot to
+ * process is the first non empty one after current on the lowest level that
+ * has one.
+ */
+struct timer_wheel::impl
+{
+  boost::asio::steady_timer driver;
+  clock::time_point const epoch = clock::now();
+
+  mutable std::mutex mutex;
+  std::uint64_t current = 0;
+  std::array<timer_node*, nb_buckets> heads{};
+  std::array<timer_node*, nb_buckets> tails{};
+  // bit i of occupied[l] is set when slot i of level l is not empty
+  std::array<std::uint64_t, nb_levels> occupied{};
+  std::size_t size = 0;
+  // tick the driver is waiting for
+  std::optional<std::uint64_t> armed;
+
+  explicit impl(boost::asio::io_context& io) : driver(io)
+  {
+  }
+
+  // rounded up so that timers never fire early
+  std::uint64_t deadline_tick(clock::time_point deadline) const
+  {
+    if (deadline <= epoch)
+      return 0;
+    return static_cast<std::uint64_t>(
+        std::chrono::ceil<std::chrono::milliseconds>(deadline - epoch)
+            .count());
+  }
+
+  std::uint64_t elapsed_tick(clock::time_point now) const
+  {
+    return static_cast<std::uint64_t>(
+        std::chrono::floor<std::chrono::milliseconds>(now - epoch).count());
+  }
+
+  void link(timer_node* timer)
+  {
+    auto bucket = far_bucket;
+    if (timer->_expiry <= current)
+      bucket = due_bucket;
+    else
+    {
+      for (unsigned level = 0; level < nb_levels; ++level)
+      {
+        auto const block_shift = level_bits * (level + 1);
+        if ((timer->_expiry >> block_shift) != (current >> block_shift))
+          continue;
+        auto const slot = static_cast<unsigned>(
+            (timer->_expiry >> (level_bits * level)) & (slots_per_level - 1));
+        bucket = level * slots_per_level + slot;
+        occupied[level] |= std::uint64_t{1} << slot;
+        break;
+      }
+    }
+
+    timer->_bucket = bucket;
+    timer->_next = nullptr;
+    timer->_prev = tails[bucket];
+    if (tails[bucket])
+      tails[bucket]->_next = timer;
+    else
+      heads[bucket] = timer;
+    tails[bucket] = timer;
+  }
+
+  void mark_empty(std::size_t bucket)
+  {
+    if (bucket < due_bucket)
+      occupied[bucket / slots_per_level] &=
+          ~(std::uint64_t{1} << (bucket % slots_per_level));
+  }
+
+  void unlink(timer_node* timer)
+  {
+    auto const bucket = timer->_bucket;
+    if (timer->_prev)
+      timer->_prev->_next = timer->_next;
+    else
+      heads[bucket] = timer->_next;
+    if (timer->_next)
+      timer->_next->_prev = timer->_prev;
+    else
+      tails[bucket] = timer->_prev;
+    if (!heads[bucket])
+      mark_empty(bucket);
+    timer->_prev = timer->_next = nullptr;
+    timer->_bucket = timer_node::no_bucket;
+  }
+
+  std::optional<event> next_event() const
+  {
+    if (heads[due_bucket])
+      return event{current, due_bucket};
+    for (unsigned level = 0; level < nb_levels; ++level)
+    {
+      auto const shift = level_bits * level;
+      auto const slot = (current >> shift) & (slots_per_level - 1);
+      auto const later =
+          slot == slots_per_level - 1 ?
+              0 :
+              occupied[level] & (~std::uint64_t{0} << (slot + 1));
+      if (!later)
+        continue;
+      auto const next = lowest_bit(later);
+      auto const block_shift = shift + level_bits;
+      return event{((current >> block_shift) << block_shift) +
+                       (std::uint64_t{next} << shift),
+                   level * slots_per_level + next};
+    }
+    if (heads[far_bucket])
+    {
+      auto const block_shift = level_bits * nb_levels;
+      return event{((current >> block_shift) + 1) << block_shift, far_bucket};
+    }
+    return std::nullopt;
+  }
+
+  // Process the slots up to \p now and move the expired timers to \p fired
+  void advance(std::uint64_t now,
+               std::vector<std::shared_ptr<timer_node>>& fired)
+  {
+    while (true)
+    {
+      auto const ev = next_event();
+      if (!ev || ev->time > now)
+        break;
+
+      current = ev->time;
+      auto timer = std::exchange(heads[ev->bucket], nullptr);
+      tails[ev->bucket] = nullptr;
+      mark_empty(ev->bucket);
+      // the timers of a higher level slot go down to the lower levels
+      while (timer)
+      {
+        auto const next = timer->_next;
+        if (timer->_expiry <= current)
+        {
+          timer->_prev = timer->_next = nullptr;
+          timer->_bucket = timer_node::no_bucket;
+          --size;
+          fired.push_back(std::move(timer->_self));
+        }
+        else
+          link(timer);
+        timer = next;
+      }
+    }
+    current = std::max(current, now);
+  }
+
+  void rearm(timer_wheel& wheel)
+  {
+    auto const ev = next_event();
+    if (!ev || (armed && *armed <= ev->time))
+      return;
+    armed = ev->time;
+    driver.expires_at(
+        epoch + std::chrono::milliseconds(
+                    static_cast<std::chrono::milliseconds::rep>(ev->time)));
+    driver.async_wait([&wheel](boost::system::error_code const& ec) {
+      if (ec != boost::asio::error::operation_aborted)
+        wheel.on_driver();
+    });
+  }
+};
+
+timer_wheel& timer_wheel::get(boost::asio::io_context& io)
+{
+  return boost::asio::use_service<timer_wheel>(io);
+}
+
+timer_wheel::timer_wheel(boost::asio::io_context& io)
+  : boost::asio::io_context::service(io), _impl(std::make_unique<impl>(io))
+{
+}
+
+timer_wheel::~timer_wheel() = default;
+
+void timer_wheel::arm(std::shared_ptr<timer_node> timer,
+                      clock::time_point deadline,
+                      clock::duration slack)
+{
+  assert(timer && timer->_bucket == timer_node::no_bucket);
+
+  std::lock_guard<std::mutex> l(_impl->mutex);
+  // catch up with the clock when nothing is due, so that the timer goes in a
+  // low level
+  auto const now = clock::now();
+  auto const now_tick = _impl->elapsed_tick(now);
+  auto const ev = _impl->next_event();
+  if (!ev || ev->time > now_tick)
+    _impl->current = std::max(_impl->current, now_tick);
+
+  auto& node = *timer;
+  // a deadline that is already passed must not wait for the next tick
+  if (deadline <= now)
+    node._expiry = _impl->current;
+  else
+  {
+    node._expiry = _impl->deadline_tick(deadline);
+    if (slack > clock::duration::zero())
+      node._expiry = coarsest_tick(
+          node._expiry, _impl->elapsed_tick(deadline + slack));
+  }
+  node._self = std::move(timer);
+  _impl->link(&node);
+  ++_impl->size;
+  _impl->rearm(*this);
+}
+
+bool timer_wheel::cancel(timer_node& timer)
+{
+  std::shared_ptr<timer_node> self;
+  {
+    std::lock_guard<std::mutex> l(_impl->mutex);
+    if (timer._bucket == timer_node::no_bucket)
+      return false;
+    _impl->unlink(&timer);
+    --_impl->size;
+    self = std::move(timer._self);
+  }
+  // the driver may wake up for nothing, it is cheaper than rearming it
+  return true;
+}
+
+std::size_t timer_wheel::size() const
+{
+  std::lock_guard<std::mutex> l(_impl->mutex);
+  return _impl->size;
+}
+
+void timer_wheel::on_driver()
+{
+  std::vector<std::shared_ptr<timer_node>> fired;
+  {
+    std::lock_guard<std::mutex> l(_impl->mutex);
+    _impl->armed.reset();
+    _impl->advance(_impl->elapsed_tick(clock::now()), fired);
+    _impl->rearm(*this);
+  }
+  for (auto const& timer : fired)
+    timer->fire();
+}
+
+void timer_wheel::shutdown()
+{
+  // like asio does with its timers, drop the pending ones without firing them
+  std::vector<std::shared_ptr<timer_node>> dropped;
+  {
+    std::lock_guard<std::mutex> l(_impl->mutex);
+    for (auto& head : _impl->heads)
+    {
+      for (auto timer = std::exchange(head, nullptr); timer;)
+      {
+        auto const next = timer->_next;
+        timer->_prev = timer->_next = nullptr;
+        timer->_bucket = timer_node::no_bucket;
+        dropped.push_back(std::move(timer->_self));
+        timer = next;
+      }
+    }
+    _impl->tails = {};
+    _impl->occupied = {};
+    _impl->size = 0;
+    _impl->armed.reset();
+    _impl->driver.cancel();
+  }
+}
+}
+}
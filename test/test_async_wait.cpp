@@ -24,3 +24,16 @@ TEST_CASE("async_wait should be instantly cancelable")
   auto after = std::chrono::steady_clock::now();
   CHECK(delay > after - before);
 }
+
+TEST_CASE("async_wait should get ready within its slack [waiting]")
+{
+  std::chrono::milliseconds const delay{100};
+  std::chrono::milliseconds const slack{50};
+  auto before = std::chrono::steady_clock::now();
+  auto fut = async_wait(delay, slack);
+  fut.wait();
+  auto after = std::chrono::steady_clock::now();
+  CHECK(delay < after - before);
+  // leave room for the latency of the executor
+  CHECK(after - before < delay + slack + std::chrono::milliseconds(100));
+}
@@ -2,6 +2,9 @@
 
 #include <tconcurrent/concurrent_queue.hpp>
 
+#include <memory>
+#include <vector>
+
 using namespace tconcurrent;
 
 SCENARIO("test concurrent_queue")
@@ -68,5 +71,158 @@ SCENARIO("test concurrent_queue")
 
       CHECK(0 == q.size());
     }
+  }  GIVEN("a bounded queue")
+  {
+    concurrent_queue<int> q(2);
+    THEN("async_push is ready while there is room")
+    {
+      CHECK(q.async_push(1).is_ready());
+      CHECK(q.try_push(2));
+      CHECK(2 == q.size());
+    }
+    THEN("async_push waits for room")
+    {
+      q.push(1);
+      q.push(2);
+      auto fut3 = q.async_push(3);
+      auto fut4 = q.async_push(4);
+      CHECK(!fut3.is_ready());
+      CHECK(2 == q.size());
+
+      CHECK(1 == q.pop().get());
+      CHECK(fut3.is_ready());
+      CHECK(!fut4.is_ready());
+      CHECK(2 == q.size());
+
+      CHECK(2 == q.pop().get());
+      CHECK(fut4.is_ready());
+      CHECK(3 == q.pop().get());
+      CHECK(4 == q.pop().get());
+      CHECK(0 == q.size());
+    }
+    THEN("try_push fails when full")
+    {
+      q.push(1);
+      q.push(2);
+      auto val = 3;
+      CHECK(!q.try_push(val));
+      CHECK(2 == q.size());
+      CHECK(1 == q.pop().get());
+      CHECK(q.try_push(val));
+      CHECK(2 == q.pop().get());
+      CHECK(3 == q.pop().get());
+    }
+    THEN("push waits for room without a future")
+    {
+      q.push(1);
+      q.push(2);
+      q.push(3);
+      CHECK(2 == q.size());
+      CHECK(1 == q.pop().get());
+      CHECK(2 == q.size());
+      CHECK(2 == q.pop().get());
+      CHECK(3 == q.pop().get());
+    }
+    THEN("async_push gives the item to a waiting popper")
+    {
+      auto fut = q.pop();
+      CHECK(q.async_push(42).is_ready());
+      CHECK(42 == fut.get());
+      CHECK(0 == q.size());
+    }
+  }
+}
+
+TEST_CASE("bounded concurrent_queue should not move from a rejected item")
+{
+  concurrent_queue<std::unique_ptr<int>> q(1);
+  q.push(std::make_unique<int>(1));
+  auto val = std::make_unique<int>(2);
+  CHECK(!q.try_push(std::move(val)));
+  REQUIRE(val);
+
+  auto fut = q.async_push(std::move(val));
+  CHECK(1 == *q.pop().get());
+  CHECK(fut.is_ready());
+  CHECK(2 == *q.pop().get());
+}
+
+TEST_CASE("concurrent_queue pop_batch")
+{
+  concurrent_queue<int> q;
+
+  SUBCASE("takes the available items up to the maximum")
+  {
+    for (int i = 0; i < 5; ++i)
+      q.push(i);
+    auto first = q.pop_batch(3);
+    REQUIRE(first.is_ready());
+    CHECK(std::vector<int>{0, 1, 2} == first.get());
+    CHECK(std::vector<int>{3, 4} == q.pop_batch(3).get());
+    CHECK(0 == q.size());
+  }
+  SUBCASE("waits for the first item when empty")
+  {
+    auto batch = q.pop_batch(3);
+    auto single = q.pop();
+    CHECK(!batch.is_ready());
+    q.push(1);
+    q.push(2);
+    CHECK(std::vector<int>{1} == batch.get());
+    CHECK(2 == single.get());
+  }
+  SUBCASE("makes room for waiting pushes")
+  {
+    concurrent_queue<int> bounded(2);
+    bounded.push(1);
+    bounded.push(2);
+    auto fut3 = bounded.async_push(3);
+    auto fut4 = bounded.async_push(4);
+    auto fut5 = bounded.async_push(5);
+    CHECK(std::vector<int>{1, 2} == bounded.pop_batch(10).get());
+    CHECK(fut3.is_ready());
+    CHECK(fut4.is_ready());
+    CHECK(!fut5.is_ready());
+    CHECK(std::vector<int>{3, 4} == bounded.pop_batch(10).get());
+    CHECK(fut5.is_ready());
+  }
+}
+
+TEST_CASE("concurrent_queue close")
+{
+  concurrent_queue<int> q(2);
+
+  SUBCASE("wakes up waiting pops with the end of the stream")
+  {
+    auto pop = q.pop();
+    auto batch = q.pop_batch(10);
+    auto next = q.next();
+    q.close();
+    CHECK_THROWS_AS(pop.get(), queue_closed);
+    CHECK(batch.get().empty());
+    CHECK(!next.get());
+  }
+  SUBCASE("lets the remaining items be popped")
+  {
+    q.push(1);
+    q.push(2);
+    q.close();
+    CHECK(q.is_closed());
+    CHECK(1 == q.pop().get());
+    CHECK(2 == *q.next().get());
+    CHECK(!q.next().get());
+    CHECK_THROWS_AS(q.pop().get(), queue_closed);
+  }
+  SUBCASE("refuses pushes")
+  {
+    q.push(1);
+    q.push(2);
+    auto waiting = q.async_push(3);
+    q.close();
+    CHECK_THROWS_AS(waiting.get(), queue_closed);
+    CHECK_THROWS_AS(q.async_push(4).get(), queue_closed);
+    CHECK_THROWS_AS(q.push(4), queue_closed);
+    CHECK(!q.try_push(5));
+    CHECK(2 == q.size());
   }
 }
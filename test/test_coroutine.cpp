@@ -1,6 +1,7 @@
 #include <doctest/doctest.h>
 
 #include <tconcurrent/async_wait.hpp>
+#include <tconcurrent/concurrent_queue.hpp>
 #include <tconcurrent/coroutine.hpp>
 #include <tconcurrent/lazy/sync_wait.hpp>
 #include <tconcurrent/promise.hpp>
@@ -475,3 +476,21 @@ TEST_CASE("coroutine await lazy sender void")
       async_resumable([sender]() mutable -> cotask<void> { TC_AWAIT(sender); });
   CHECK_NOTHROW(f.get());
 }
+
+TEST_CASE("coroutine consume a concurrent_queue until it is closed")
+{
+  concurrent_queue<int> q(4);
+  auto consumer = async_resumable([&]() -> cotask<int> {
+    int sum = 0;
+    while (auto item = TC_AWAIT(q.next()))
+      sum += *item;
+    TC_RETURN(sum);
+  });
+  auto producer = async_resumable([&]() -> cotask<void> {
+    for (int i = 1; i <= 100; ++i)
+      TC_AWAIT(q.async_push(i));
+    q.close();
+  });
+  producer.get();
+  CHECK(5050 == consumer.get());
+}
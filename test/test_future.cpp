@@ -10,7 +10,9 @@
 
 #include <any>
 #include <iostream>
+#include <string>
 #include <thread>
+#include <type_traits>
 
 using namespace tconcurrent;
 
@@ -198,6 +200,43 @@ TEST_CASE("then should work with non-ready future")
   th.join();
 }
 
+TEST_CASE("continuations should run in registration order")
+{
+  promise<void> prom;
+  auto fut = prom.get_future().to_shared();
+  std::vector<int> order;
+  for (int i = 0; i < 4; ++i)
+    fut.then(get_synchronous_executor(),
+             [&, i](shared_future<void> const&) { order.push_back(i); });
+
+  CHECK(order.empty());
+  prom.set_value({});
+  CHECK(std::vector<int>{0, 1, 2, 3} == order);
+}
+
+TEST_CASE("then should not lose continuations registered concurrently")
+{
+  static constexpr auto NbThreads = 4;
+  static constexpr auto NbContinuations = 100;
+
+  promise<void> prom;
+  auto fut = prom.get_future().to_shared();
+  std::atomic<int> called{0};
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < NbThreads; ++i)
+    threads.emplace_back([&] {
+      for (int j = 0; j < NbContinuations; ++j)
+        fut.then(get_synchronous_executor(),
+                 [&](shared_future<void> const&) { ++called; });
+    });
+  prom.set_value({});
+  for (auto& th : threads)
+    th.join();
+
+  CHECK(NbThreads * NbContinuations == called.load());
+}
+
 TEST_CASE("and_then should work on a ready future")
 {
   auto fut = make_ready_future(21);
@@ -267,6 +306,11 @@ TEST_CASE("then should propagate the chain name to the returned future")
   CHECK(ChainName == fut.get_chain_name());
 }
 
+static_assert(!std::is_convertible_v<std::string const&, task_name>,
+              "task_name must not refer to a string that may be destroyed");
+static_assert(!std::is_convertible_v<std::string, task_name>,
+              "task_name must not refer to a string that may be destroyed");
+
 TEST_CASE("then should set task name to chain name")
 {
   struct Executor
@@ -289,6 +333,29 @@ TEST_CASE("then should set task name to chain name")
   CHECK(ChainName == e.name.substr(0, std::strlen(ChainName)));
 }
 
+TEST_CASE("then should give the chain name and the task type to task_name")
+{
+  struct Executor
+  {
+    task_name name;
+    void post(std::function<void()> f, task_name n)
+    {
+      name = n;
+      f();
+    }
+  };
+
+  auto const ChainName = "test test";
+  Executor e;
+  auto fut =
+      make_ready_future(21).update_chain_name(ChainName).then(e, [](auto) {});
+  fut.get();
+  CHECK(ChainName == e.name.name());
+  REQUIRE(e.name.type());
+  CHECK(std::string(ChainName) + " (" + e.name.type()->name() + ")" ==
+        e.name.to_string());
+}
+
 /////////////////////////
 // promise
 /////////////////////////
@@ -551,6 +618,46 @@ TEST_CASE("continuations and cancelation")
   }
 }
 
+TEST_CASE("continuations of a ready future and cancelation")
+{
+  struct Executor
+  {
+    std::vector<std::function<void()>>* tasks;
+    void post(std::function<void()> f, task_name)
+    {
+      tasks->push_back(std::move(f));
+    }
+  };
+
+  unsigned called = 0;
+  std::vector<std::function<void()>> tasks;
+  Executor e{&tasks};
+  auto fut = make_ready_future(18);
+
+  SUBCASE("then with cancel before execution")
+  {
+    auto fut2 = fut.then(e, [&](cancelation_token& token, future<int> const&) {
+      ++called;
+      CHECK(token.is_cancel_requested());
+    });
+    fut2.request_cancel();
+    REQUIRE(1 == tasks.size());
+    tasks[0]();
+    fut2.get();
+    CHECK(1 == called);
+  }
+
+  SUBCASE("and_then with cancel before execution")
+  {
+    auto fut2 = fut.and_then(e, [&](int) { ++called; });
+    fut2.request_cancel();
+    REQUIRE(1 == tasks.size());
+    tasks[0]();
+    CHECK_THROWS_AS(fut2.get(), operation_canceled);
+    CHECK(0 == called);
+  }
+}
+
 TEST_CASE(
     "break_cancelation_chain should prevent cancel propagation from first "
     "future to second")
@@ -0,0 +1,122 @@
+#include <doctest/doctest.h>
+
+#include <tconcurrent/async.hpp>
+#include <tconcurrent/inline_executor.hpp>
+#include <tconcurrent/promise.hpp>
+
+#include <algorithm>
+#include <thread>
+
+using namespace tconcurrent;
+
+TEST_CASE("inline_executor should run continuations in place in its context")
+{
+  async([] {
+    promise<void> prom;
+    bool called = false;
+    auto fut = prom.get_future().and_then(
+        inline_executor(get_default_executor()), [&](tvoid) { called = true; });
+    prom.set_value({});
+    CHECK(called);
+    CHECK(fut.is_ready());
+  }).get();
+}
+
+#ifndef EMSCRIPTEN
+TEST_CASE("inline_executor should post work from outside its context")
+{
+  auto const this_thread = std::this_thread::get_id();
+  promise<void> prom;
+  auto fut = prom.get_future().and_then(
+      inline_executor(get_default_executor()),
+      [&](tvoid) { return std::this_thread::get_id(); });
+  prom.set_value({});
+  CHECK(this_thread != fut.get());
+}
+#endif
+
+TEST_CASE("inline_executor should be usable with a priority")
+{
+  async([] {
+    promise<void> prom;
+    bool called = false;
+    auto fut = prom.get_future().then(
+        inline_executor(get_default_executor()),
+        task_priority::high,
+        [&](future<void> const&) { called = true; });
+    auto fut2 = async(inline_executor(get_default_executor()),
+                      task_priority::low,
+                      [] { return 42; });
+    prom.set_value({});
+    CHECK(called);
+    CHECK(fut.is_ready());
+    CHECK(42 == fut2.get());
+  }).get();
+}
+
+TEST_CASE("inline_executor should not nest more than max_depth tasks")
+{
+  static constexpr auto ChainLength = 100;
+  static constexpr auto MaxDepth = 4u;
+
+  unsigned called = 0;
+  unsigned max_depth = 0;
+  async([&] {
+    promise<void> prom;
+    auto fut = prom.get_future();
+    for (int i = 0; i < ChainLength; ++i)
+      fut = fut.and_then(inline_executor(get_default_executor(), MaxDepth),
+                         [&](tvoid) {
+                           ++called;
+                           max_depth = std::max(
+                               max_depth, detail::inline_execution_depth());
+                         });
+    prom.set_value({});
+    return fut;
+  })
+      .unwrap()
+      .get();
+
+  CHECK(ChainLength == called);
+  CHECK(MaxDepth == max_depth);
+}
+
+TEST_CASE("inline_executor should report errors to the adapted executor")
+{
+  struct Executor
+  {
+    std::exception_ptr error;
+
+    void post(fu2::unique_function<void()> f, task_name)
+    {
+      f();
+    }
+    bool is_in_this_context() const
+    {
+      return true;
+    }
+    void signal_error(std::exception_ptr const& e)
+    {
+      error = e;
+    }
+    // unused, required by executor
+    boost::asio::io_context& get_io_service()
+    {
+      throw std::logic_error("unused");
+    }
+    bool is_single_threaded() const
+    {
+      return true;
+    }
+    void stop_before_fork()
+    {
+    }
+    void resume_after_fork()
+    {
+    }
+  };
+
+  Executor e;
+  inline_executor(e).post([] { throw 42; });
+  CHECK_THROWS_AS(std::rethrow_exception(e.error), int);
+}
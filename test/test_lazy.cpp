@@ -5,6 +5,7 @@
 #include <tconcurrent/lazy/sink_receiver.hpp>
 #include <tconcurrent/lazy/sync_wait.hpp>
 #include <tconcurrent/lazy/then.hpp>
+#include <tconcurrent/lazy/with_timeout.hpp>
 
 #include <tconcurrent/coroutine.hpp>
 
@@ -273,6 +274,46 @@ TEST_CASE("lazy async_wait [waiting]")
   CHECK(delay < after - before);
 }
 
+// with_timeout
+
+TEST_CASE("lazy with_timeout with value")
+{
+  lazy::cancelation_token c;
+  auto const sender = lazy::with_timeout(
+      get_default_executor(),
+      make_sender<int>([](auto&& receiver) { receiver.set_value(42); }),
+      std::chrono::hours(1));
+  CHECK(lazy::sync_wait(sender, c) == 42);
+}
+
+TEST_CASE("lazy with_timeout cancels the sender when the timeout expires")
+{
+  bool canceled = false;
+  lazy::cancelation_token c;
+  auto const sender = lazy::with_timeout(
+      get_default_executor(),
+      make_sender<void>([&](auto receiver) {
+        receiver.get_cancelation_token()->set_canceler([&, receiver]() mutable {
+          canceled = true;
+          receiver.set_done();
+        });
+      }),
+      std::chrono::milliseconds(10));
+  CHECK_THROWS_AS(lazy::sync_wait(sender, c), timed_out);
+  CHECK(canceled);
+}
+
+TEST_CASE("lazy with_timeout propagates cancelation requests")
+{
+  lazy::cancelation_token c;
+  c.request_cancel();
+  auto const sender = lazy::with_timeout(
+      get_default_executor(),
+      lazy::async_wait(get_default_executor(), std::chrono::hours(1)),
+      std::chrono::hours(1));
+  CHECK_THROWS_AS(lazy::sync_wait(sender, c), operation_canceled);
+}
+
 // cancelation_token
 
 TEST_CASE("is_cancel_requested is true after request_cancel")
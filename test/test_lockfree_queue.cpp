@@ -0,0 +1,120 @@
+#include <doctest/doctest.h>
+
+#include <tconcurrent/lockfree_queue.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace tconcurrent;
+
+SCENARIO("test lockfree_queue")
+{
+  GIVEN("an empty queue")
+  {
+    lockfree_queue<int> q;
+    THEN("it is empty")
+    {
+      CHECK(0 == q.size());
+      CHECK(!q.try_pop());
+    }
+    THEN("pushing unlocks poppers in order")
+    {
+      auto fut1 = q.pop();
+      auto fut2 = q.pop();
+      CHECK(!fut1.is_ready());
+      CHECK(0 == q.size());
+      q.push(18);
+      q.push(19);
+      CHECK(fut1.is_ready());
+      CHECK(18 == fut1.get());
+      CHECK(19 == fut2.get());
+      CHECK(0 == q.size());
+    }
+  }
+  GIVEN("a queue with 3 values")
+  {
+    lockfree_queue<int> q;
+    q.push(1);
+    q.push(2);
+    q.push(3);
+    THEN("it holds 3 values")
+    {
+      CHECK(3 == q.size());
+    }
+    THEN("we can pop in the same order")
+    {
+      CHECK(1 == q.pop().get());
+      CHECK(2 == *q.try_pop());
+      CHECK(3 == q.pop().get());
+
+      CHECK(0 == q.size());
+      CHECK(!q.try_pop());
+    }
+  }
+  GIVEN("a queue with a small ring")
+  {
+    lockfree_queue<std::unique_ptr<int>> q(4);
+    THEN("items overflow from the ring in order")
+    {
+      for (int i = 0; i < 20; ++i)
+        q.push(std::make_unique<int>(i));
+      CHECK(20 == q.size());
+      for (int i = 0; i < 10; ++i)
+        CHECK(i == *q.pop().get());
+      for (int i = 20; i < 25; ++i)
+        q.push(std::make_unique<int>(i));
+      for (int i = 10; i < 25; ++i)
+        CHECK(i == **q.try_pop());
+      CHECK(0 == q.size());
+    }
+  }
+}
+
+TEST_CASE("lockfree_queue should keep the order of each producer")
+{
+  constexpr auto nb_producers = 4;
+  constexpr auto nb_consumers = 4;
+  constexpr auto nb_items = 20000;
+
+  // a small ring to go through the overflow path too
+  lockfree_queue<std::pair<int, int>> q(64);
+  std::vector<std::vector<std::pair<int, int>>> popped(nb_consumers);
+
+  std::vector<std::thread> threads;
+  for (int c = 0; c < nb_consumers; ++c)
+    threads.emplace_back([&, c] {
+      for (int i = 0; i < nb_producers * nb_items / nb_consumers; ++i)
+      {
+        if (i % 2)
+          popped[c].push_back(q.pop().get());
+        else if (auto val = q.try_pop())
+          popped[c].push_back(*val);
+        else
+          --i;
+      }
+    });
+  for (int p = 0; p < nb_producers; ++p)
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < nb_items; ++i)
+        q.push({p, i});
+    });
+  for (auto& thread : threads)
+    thread.join();
+
+  CHECK(0 == q.size());
+  std::vector<int> counts(nb_producers);
+  for (auto const& items : popped)
+  {
+    std::vector<int> last(nb_producers, -1);
+    for (auto const& [producer, i] : items)
+    {
+      // a consumer sees the items of a producer in order
+      CHECK(i > last[producer]);
+      last[producer] = i;
+      ++counts[producer];
+    }
+  }
+  for (auto const count : counts)
+    CHECK(nb_items == count);
+}
@@ -0,0 +1,64 @@
+#include <doctest/doctest.h>
+
+#include <tconcurrent/detail/node_pool.hpp>
+
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace tconcurrent;
+
+TEST_CASE("node pool should reuse blocks freed on the same thread")
+{
+  auto const p = detail::pool_allocate(100);
+  detail::pool_deallocate(p, 100);
+
+  SUBCASE("of the same size")
+  {
+    auto const q = detail::pool_allocate(100);
+    CHECK(p == q);
+    detail::pool_deallocate(q, 100);
+  }
+  SUBCASE("of the same size class")
+  {
+    auto const q = detail::pool_allocate(128);
+    CHECK(p == q);
+    detail::pool_deallocate(q, 128);
+  }
+}
+
+TEST_CASE("node pool should allocate big blocks")
+{
+  auto const p = detail::pool_allocate(detail::max_pooled_size * 4);
+  std::memset(p, 0, detail::max_pooled_size * 4);
+  detail::pool_deallocate(p, detail::max_pooled_size * 4);
+}
+
+TEST_CASE("node pool should accept blocks freed on other threads")
+{
+  constexpr auto nb_blocks = 1000;
+
+  std::vector<void*> blocks;
+  for (int i = 0; i < nb_blocks; ++i)
+    blocks.push_back(detail::pool_allocate(64));
+
+  std::thread([&] {
+    for (auto const block : blocks)
+      detail::pool_deallocate(block, 64);
+  }).join();
+
+  // the exiting thread gave the blocks to the depot, they can be taken again
+  blocks.clear();
+  for (int i = 0; i < nb_blocks; ++i)
+    blocks.push_back(detail::pool_allocate(64));
+  for (auto const block : blocks)
+    detail::pool_deallocate(block, 64);
+}
+
+TEST_CASE("pool_allocator should work with allocate_shared")
+{
+  auto const p = std::allocate_shared<std::vector<int>>(
+      detail::pool_allocator<std::vector<int>>(), 3, 42);
+  CHECK(std::vector<int>{42, 42, 42} == *p);
+}
@@ -141,6 +141,36 @@ TEST_CASE("cancelable packaged_task should not run if canceled")
   CHECK_THROWS_AS(future.get(), operation_canceled);
 }
 
+TEST_CASE(
+    "cancelable packaged_task should not run if a continuation is canceled")
+{
+  auto taskfut = package_cancelable<void()>([&]() { CHECK(false); });
+  auto& task = std::get<0>(taskfut);
+  auto& future = std::get<1>(taskfut);
+
+  auto fut2 = future.then(get_synchronous_executor(),
+                          [](tconcurrent::future<void> const&) {});
+  fut2.request_cancel();
+
+  CHECK(future.is_ready());
+  task(); // should do nothing
+  CHECK_THROWS_AS(future.get(), operation_canceled);
+}
+
+TEST_CASE("cancelable packaged_task should ignore a cancel once it has run")
+{
+  auto taskfut = package_cancelable<int()>([&](cancelation_token& token) {
+    CHECK(!token.is_cancel_requested());
+    return 42;
+  });
+  auto& task = std::get<0>(taskfut);
+  auto& future = std::get<1>(taskfut);
+
+  task();
+  future.request_cancel();
+  CHECK(42 == future.get());
+}
+
 TEST_CASE("packaged_task_result_type should be correct")
 {
   {
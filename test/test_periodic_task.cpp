@@ -39,6 +39,20 @@ TEST_CASE("test periodic task [waiting]")
   CHECK(3 <= called);
 }
 
+TEST_CASE("test periodic task with slack [waiting]")
+{
+  unsigned int called = 0;
+
+  periodic_task pt;
+  pt.set_callback([&] { ++called; });
+  pt.set_period(std::chrono::milliseconds(100), std::chrono::milliseconds(10));
+  pt.start();
+  async_wait(std::chrono::milliseconds(480)).get();
+  pt.stop().get();
+  CHECK(4 >= called);
+  CHECK(3 <= called);
+}
+
 TEST_CASE("test periodic task future [waiting]")
 {
   unsigned int called = 0;
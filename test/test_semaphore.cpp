@@ -2,6 +2,10 @@
 
 #include <tconcurrent/semaphore.hpp>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 using namespace tconcurrent;
 
 SCENARIO("test semaphore")
@@ -68,3 +72,95 @@ SCENARIO("test semaphore")
     }
   }
 }
+
+TEST_CASE("semaphore acquires and releases several permits")
+{
+  semaphore sem{5};
+  CHECK(sem.acquire(3).is_ready());
+  CHECK(2 == sem.count());
+
+  auto fut = sem.acquire(3);
+  CHECK(!fut.is_ready());
+  CHECK(2 == sem.count());
+
+  sem.release(2);
+  CHECK(fut.is_ready());
+  CHECK(1 == sem.count());
+
+  SUBCASE("with a scope_lock")
+  {
+    {
+      auto l = sem.get_scope_lock(4);
+      CHECK(!l.is_ready());
+      sem.release(3);
+      REQUIRE(l.is_ready());
+      CHECK(0 == sem.count());
+    }
+    CHECK(4 == sem.count());
+  }
+}
+
+TEST_CASE("semaphore try_acquire")
+{
+  semaphore sem{2};
+  CHECK(sem.try_acquire(2));
+  CHECK(!sem.try_acquire());
+  sem.release();
+  CHECK(sem.try_acquire());
+  CHECK(0 == sem.count());
+}
+
+TEST_CASE("semaphore serves waiters in order")
+{
+  semaphore sem{0};
+  auto big = sem.acquire(3);
+  auto small = sem.acquire(1);
+
+  sem.release(2);
+  // small must not overtake big, and neither must a new acquire
+  CHECK(!big.is_ready());
+  CHECK(!small.is_ready());
+  CHECK(!sem.try_acquire());
+  CHECK(2 == sem.count());
+
+  sem.release(2);
+  CHECK(big.is_ready());
+  CHECK(small.is_ready());
+  CHECK(0 == sem.count());
+
+  // once nobody waits, the fast path is back
+  sem.release();
+  CHECK(sem.try_acquire());
+}
+
+TEST_CASE("semaphore limits concurrent holders across threads")
+{
+  constexpr auto nb_permits = 3;
+  constexpr auto nb_threads = 8;
+  constexpr auto nb_iterations = 2000;
+
+  semaphore sem{nb_permits};
+  std::atomic<int> holders{0};
+  std::atomic<int> max_holders{0};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nb_threads; ++t)
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < nb_iterations; ++i)
+      {
+        std::size_t const n = (t + i) % 2 + 1;
+        sem.acquire(n).get();
+        auto const now = holders += n;
+        auto max = max_holders.load();
+        while (now > max && !max_holders.compare_exchange_weak(max, now))
+          ;
+        holders -= n;
+        sem.release(n);
+      }
+    });
+  for (auto& thread : threads)
+    thread.join();
+
+  CHECK(max_holders.load() <= nb_permits);
+  CHECK(nb_permits == sem.count());
+}
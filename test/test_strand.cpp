@@ -0,0 +1,94 @@
+#include <doctest/doctest.h>
+
+#include <tconcurrent/async.hpp>
+#include <tconcurrent/coroutine.hpp>
+#include <tconcurrent/strand.hpp>
+
+#ifndef EMSCRIPTEN
+#include <tconcurrent/thread_pool.hpp>
+#endif
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace tconcurrent;
+
+TEST_CASE("strand should run tasks in the order they were posted")
+{
+  strand s(get_default_executor());
+  std::vector<int> order;
+  for (int i = 0; i < 100; ++i)
+    s.post([&, i] { order.push_back(i); });
+  async(s, [] {}).get();
+
+  REQUIRE(100 == order.size());
+  for (int i = 0; i < 100; ++i)
+    CHECK(i == order[i]);
+}
+
+TEST_CASE("strand should only be in its context while running its tasks")
+{
+  strand s(get_default_executor());
+  CHECK(!s.is_in_this_context());
+  CHECK(async(s, [&] { return s.is_in_this_context(); }).get());
+  CHECK(!async([&] { return s.is_in_this_context(); }).get());
+
+  strand other(get_default_executor());
+  CHECK(!async(s, [&] { return other.is_in_this_context(); }).get());
+}
+
+#ifndef EMSCRIPTEN
+TEST_CASE("strand should not run tasks concurrently on a thread_pool")
+{
+  static constexpr auto NbProducers = 4;
+  static constexpr auto NbTasks = 1000;
+
+  thread_pool tp;
+  tp.start(4, thread_pool::scheduling::work_stealing);
+  strand s(tp);
+
+  std::atomic<int> running{0};
+  bool overlapped = false;
+  std::vector<std::vector<int>> seen(NbProducers);
+  std::vector<std::thread> producers;
+  for (int p = 0; p < NbProducers; ++p)
+    producers.emplace_back([&, p] {
+      for (int i = 0; i < NbTasks; ++i)
+        s.post([&, p, i] {
+          if (++running != 1)
+            overlapped = true;
+          seen[p].push_back(i);
+          --running;
+        });
+    });
+  for (auto& th : producers)
+    th.join();
+  async(s, [] {}).get();
+
+  CHECK(!overlapped);
+  for (auto const& values : seen)
+  {
+    REQUIRE(NbTasks == values.size());
+    for (int i = 0; i < NbTasks; ++i)
+      CHECK(i == values[i]);
+  }
+}
+
+TEST_CASE("strand should run coroutines")
+{
+  thread_pool tp;
+  tp.start(2);
+  strand s(tp);
+
+  auto f = async_resumable("test", executor(s), [&]() -> cotask<int> {
+    CHECK(s.is_in_this_context());
+    TC_YIELD();
+    CHECK(s.is_in_this_context());
+    auto const i = TC_AWAIT(async(tp, [] { return 21; }));
+    CHECK(s.is_in_this_context());
+    TC_RETURN(i * 2);
+  });
+  CHECK(42 == f.get());
+}
+#endif
@@ -1,8 +1,17 @@
 #include <doctest/doctest.h>
 
+#include <tconcurrent/async.hpp>
+#include <tconcurrent/async_wait.hpp>
+#include <tconcurrent/blocking_region.hpp>
+#include <tconcurrent/promise.hpp>
 #include <tconcurrent/thread_pool.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <thread>
 
 using namespace tconcurrent;
 
@@ -72,3 +81,523 @@ TEST_CASE("is_in_this_context should work")
   CHECK_FALSE(tp.is_in_this_context());
   tp.post([&] { CHECK(get_default_executor().is_in_this_context()); });
 }
+
+TEST_CASE("test thread_pool work_stealing run work")
+{
+  bool called = false;
+
+  thread_pool tp;
+  tp.start(2, thread_pool::scheduling::work_stealing);
+  tp.post([&] { called = true; });
+  tp.stop();
+  CHECK(called);
+}
+
+TEST_CASE("test thread_pool work_stealing runs tasks posted from workers")
+{
+  static constexpr auto NbTasks = 1000;
+  std::atomic<int> called{0};
+
+  thread_pool tp;
+  tp.start(4, thread_pool::scheduling::work_stealing);
+  tp.post([&] {
+    for (int i = 0; i < NbTasks; ++i)
+      tp.post([&] {
+        CHECK(tp.is_in_this_context());
+        ++called;
+      });
+  });
+  tp.stop();
+  CHECK(NbTasks == called.load());
+}
+
+TEST_CASE("test thread_pool work_stealing error work")
+{
+  bool called = false;
+
+  thread_pool tp;
+  tp.set_error_handler([&](std::exception_ptr const& e) {
+    called = true;
+    CHECK_THROWS_AS(std::rethrow_exception(e), int);
+  });
+
+  tp.start(2, thread_pool::scheduling::work_stealing);
+  tp.post([&] { throw 18; });
+  tp.stop();
+  CHECK(called);
+}
+
+TEST_CASE("test thread_pool work_stealing runs timers [waiting]")
+{
+  thread_pool tp;
+  tp.start(2, thread_pool::scheduling::work_stealing);
+  auto fut = async_wait(tp, std::chrono::milliseconds(10))
+                 .and_then(executor(tp),
+                           [&](tvoid) { return tp.is_in_this_context(); });
+  CHECK(fut.get());
+}
+
+namespace
+{
+std::vector<fu2::unique_function<void()>> make_works(int nb,
+                                                     std::atomic<int>& called)
+{
+  std::vector<fu2::unique_function<void()>> works;
+  for (int i = 0; i < nb; ++i)
+    works.push_back([&] { ++called; });
+  return works;
+}
+}
+
+TEST_CASE("test thread_pool post_bulk")
+{
+  static constexpr auto NbTasks = 1000;
+
+  for (auto const sched : {thread_pool::scheduling::shared_queue,
+                           thread_pool::scheduling::work_stealing})
+  {
+    for (auto const from_worker : {false, true})
+    {
+      std::atomic<int> called{0};
+      thread_pool tp;
+      tp.start(4, sched);
+      if (from_worker)
+        tp.post([&] { tp.post_bulk(make_works(NbTasks, called)); });
+      else
+        tp.post_bulk(make_works(NbTasks, called));
+      tp.stop();
+      CHECK(NbTasks == called.load());
+    }
+  }
+}
+
+TEST_CASE("test thread_pool post_bulk should not wait behind a slow task")
+{
+  std::atomic<int> called{0};
+  bool others_ran = false;
+
+  thread_pool tp;
+  tp.start(2);
+  auto works = make_works(3, called);
+  works.insert(works.begin(), [&] {
+    auto const deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (called.load() < 3 && std::chrono::steady_clock::now() < deadline)
+      std::this_thread::yield();
+    others_ran = called.load() == 3;
+  });
+  tp.post_bulk(std::move(works));
+  tp.stop();
+  CHECK(others_ran);
+}
+
+TEST_CASE("test thread_pool post_bulk error work")
+{
+  std::atomic<int> called{0};
+  std::atomic<int> errors{0};
+
+  thread_pool tp;
+  tp.set_error_handler([&](std::exception_ptr const& e) {
+    ++errors;
+    CHECK_THROWS_AS(std::rethrow_exception(e), int);
+  });
+
+  tp.start(1);
+  auto works = make_works(2, called);
+  works.insert(works.begin() + 1, [] { throw 18; });
+  tp.post_bulk(std::move(works));
+  tp.stop();
+  CHECK(2 == called.load());
+  CHECK(1 == errors.load());
+}
+
+TEST_CASE("executor post_bulk should fall back to post")
+{
+  struct context
+  {
+    int posted = 0;
+
+    void post(fu2::unique_function<void()> work, task_name)
+    {
+      ++posted;
+      work();
+    }
+    boost::asio::io_context& get_io_service()
+    {
+      throw std::logic_error("unused");
+    }
+    bool is_single_threaded() const
+    {
+      return true;
+    }
+    bool is_in_this_context() const
+    {
+      return true;
+    }
+    void signal_error(std::exception_ptr const&)
+    {
+    }
+    void stop_before_fork()
+    {
+    }
+    void resume_after_fork()
+    {
+    }
+  };
+
+  std::atomic<int> called{0};
+  context ctx;
+  executor(ctx).post_bulk(make_works(3, called));
+  CHECK(3 == ctx.posted);
+  CHECK(3 == called.load());
+}
+
+TEST_CASE("test thread_pool runs higher priority tasks first")
+{
+  for (auto const sched : {thread_pool::scheduling::shared_queue,
+                           thread_pool::scheduling::work_stealing})
+  {
+    std::vector<task_priority> order;
+    promise<void> unblock;
+    thread_pool tp;
+    tp.start(1, sched);
+    tp.post([fut = unblock.get_future()]() mutable { fut.get(); });
+    for (auto const priority :
+         {task_priority::low, task_priority::normal, task_priority::high})
+      tp.post([&, priority] { order.push_back(priority); }, priority);
+    unblock.set_value({});
+    tp.stop();
+    CHECK(order == std::vector<task_priority>{task_priority::high,
+                                              task_priority::normal,
+                                              task_priority::low});
+  }
+}
+
+TEST_CASE("test thread_pool does not starve low priority tasks")
+{
+  static constexpr auto NbHighTasks = 100;
+
+  for (auto const sched : {thread_pool::scheduling::shared_queue,
+                           thread_pool::scheduling::work_stealing})
+  {
+    int ran = 0;
+    int low_position = -1;
+    promise<void> unblock;
+    thread_pool tp;
+    tp.start(1, sched);
+    tp.post([fut = unblock.get_future()]() mutable { fut.get(); });
+    tp.post([&] { low_position = ran++; }, task_priority::low);
+    for (int i = 0; i < NbHighTasks; ++i)
+      tp.post([&] { ++ran; }, task_priority::high);
+    unblock.set_value({});
+    tp.stop();
+    CHECK(NbHighTasks + 1 == ran);
+    CHECK(low_position > 0);
+    CHECK(low_position <= 16);
+  }
+}
+
+TEST_CASE("async and then should post with the given priority")
+{
+  std::vector<int> order;
+  promise<void> unblock;
+  thread_pool tp;
+  tp.start(1);
+  tp.post([fut = unblock.get_future()]() mutable { fut.get(); });
+  auto low =
+      async(tp, task_priority::low, [&] { order.push_back(0); });
+  auto high =
+      low.then(tp, task_priority::high, [&](future<void> const&) {
+        order.push_back(1);
+      });
+  auto normal = async(tp, [&] { order.push_back(2); });
+  auto high2 =
+      async(tp, task_priority::high, [&] { order.push_back(3); });
+  unblock.set_value({});
+  tp.stop();
+  // the then() callback is only posted once the low task is done
+  CHECK(order == std::vector<int>{3, 2, 0, 1});
+}
+
+TEST_CASE("executor should ignore priorities the context does not support")
+{
+  struct context
+  {
+    int posted = 0;
+
+    void post(fu2::unique_function<void()> work, task_name)
+    {
+      ++posted;
+      work();
+    }
+    boost::asio::io_context& get_io_service()
+    {
+      throw std::logic_error("unused");
+    }
+    bool is_single_threaded() const
+    {
+      return true;
+    }
+    bool is_in_this_context() const
+    {
+      return true;
+    }
+    void signal_error(std::exception_ptr const&)
+    {
+    }
+    void stop_before_fork()
+    {
+    }
+    void resume_after_fork()
+    {
+    }
+  };
+
+  context ctx;
+  auto fut = async(ctx, task_priority::high, [] { return 42; });
+  CHECK(1 == ctx.posted);
+  CHECK(42 == fut.get());
+}
+
+TEST_CASE("test thread_pool numa_nodes returns available CPUs")
+{
+  auto const available = thread_pool::available_cpus();
+  for (auto const& node : thread_pool::numa_nodes())
+  {
+    CHECK(!node.empty());
+    for (auto const cpu : node)
+      CHECK(std::find(available.begin(), available.end(), cpu) !=
+            available.end());
+  }
+}
+
+TEST_CASE("test thread_pool start with an unavailable CPU should throw")
+{
+  thread_pool tp;
+  CHECK_THROWS_AS(
+      tp.start({1,
+                thread_pool::scheduling::shared_queue,
+                {{std::numeric_limits<unsigned int>::max()}}}),
+      std::invalid_argument);
+  CHECK(!tp.is_running());
+}
+
+TEST_CASE("test thread_pool pinned workers run tasks with locality hints")
+{
+  static constexpr auto NbTasks = 100;
+
+  auto const nodes = thread_pool::numa_nodes();
+  if (nodes.empty())
+    return;
+
+  for (auto const sched : {thread_pool::scheduling::shared_queue,
+                           thread_pool::scheduling::work_stealing})
+  {
+    std::atomic<int> called{0};
+    std::atomic<int> in_range{0};
+    thread_pool tp;
+    // two domains that share the same CPUs
+    tp.start({4, sched, {nodes[0], nodes[0]}});
+    CHECK(2 == tp.domain_count());
+    CHECK(!tp.current_locality());
+    for (int i = 0; i < NbTasks; ++i)
+      tp.post(
+          [&] {
+            ++called;
+            auto const where = tp.current_locality();
+            if (sched == thread_pool::scheduling::shared_queue ||
+                (where && where->domain < 2))
+              ++in_range;
+          },
+          thread_pool::locality{static_cast<unsigned int>(i % 2)});
+    tp.stop();
+    CHECK(NbTasks == called.load());
+    CHECK(NbTasks == in_range.load());
+  }
+}
+
+TEST_CASE("test thread_pool elastic mode needs a thread")
+{
+  thread_pool tp;
+  thread_pool::start_config config;
+  config.thread_count = 0;
+  config.max_thread_count = 4;
+  CHECK_THROWS_AS(tp.start(config), std::invalid_argument);
+}
+
+TEST_CASE("test thread_pool elastic mode grows and shrinks [waiting]")
+{
+  for (auto const sched : {thread_pool::scheduling::shared_queue,
+                           thread_pool::scheduling::work_stealing})
+  {
+    thread_pool tp;
+    thread_pool::start_config config;
+    config.thread_count = 1;
+    config.sched = sched;
+    config.max_thread_count = 4;
+    config.idle_timeout = std::chrono::milliseconds(20);
+    // the growth is what is tested here, not the compensation
+    config.max_compensation_threads = 0;
+    tp.start(config);
+    CHECK(1 == tp.thread_count());
+
+    // the first task blocks the only thread until the second one runs
+    promise<void> unblock;
+    auto blocked =
+        async(tp, [fut = unblock.get_future()]() mutable { fut.get(); });
+    tp.post([&] { unblock.set_value({}); });
+    blocked.get();
+    CHECK(tp.thread_count() >= 2);
+
+    for (int i = 0; i < 100 && tp.thread_count() > 1; ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    CHECK(1 == tp.thread_count());
+  }
+}
+
+TEST_CASE("test thread_pool compensates workers blocked on futures")
+{
+  for (auto const sched : {thread_pool::scheduling::shared_queue,
+                           thread_pool::scheduling::work_stealing})
+  {
+    thread_pool tp;
+    tp.start(2, sched);
+
+    // both workers wait for a task that can only run on a third thread
+    promise<void> unblock;
+    auto unblocked = unblock.get_future().to_shared();
+    std::vector<future<void>> blocked;
+    std::vector<future<void>> started;
+    for (int i = 0; i < 2; ++i)
+    {
+      promise<void> start;
+      started.push_back(start.get_future());
+      blocked.push_back(async(tp, [=]() mutable {
+        start.set_value({});
+        unblocked.get();
+      }));
+    }
+    for (auto& fut : started)
+      fut.get();
+    tp.post([&] { unblock.set_value({}); });
+    for (auto& fut : blocked)
+      fut.get();
+  }
+}
+
+TEST_CASE("test thread_pool compensates workers in a blocking_region")
+{
+  thread_pool tp;
+  tp.start(2);
+
+  std::promise<void> unblock;
+  auto unblocked = unblock.get_future().share();
+  std::atomic<int> started{0};
+  std::vector<future<void>> blocked;
+  for (int i = 0; i < 2; ++i)
+    blocked.push_back(async(tp, [&, unblocked] {
+      blocking_region region;
+      ++started;
+      unblocked.wait();
+    }));
+  while (started.load() < 2)
+    std::this_thread::yield();
+  async(tp, [&] { unblock.set_value(); }).get();
+  for (auto& fut : blocked)
+    fut.get();
+}
+
+TEST_CASE("test latency_histogram percentiles are within a bucket")
+{
+  latency_histogram h;
+  for (int i = 1; i <= 1000; ++i)
+    h.record(std::chrono::microseconds(i));
+
+  CHECK(1000 == h.count());
+  CHECK(std::chrono::microseconds(1000) == h.max());
+  CHECK(std::chrono::nanoseconds(500500) == h.mean());
+  for (auto const ratio : {0.5, 0.9, 0.99})
+  {
+    auto const expected = ratio * 1000000;
+    auto const actual = static_cast<double>(h.percentile(ratio).count());
+    CHECK(actual >= expected);
+    CHECK(actual <= expected * 1.125);
+  }
+  CHECK(h.max() == h.percentile(1));
+}
+
+TEST_CASE("test latency_histogram buckets cover all durations")
+{
+  for (std::size_t i = 1; i < latency_histogram::bucket_count; ++i)
+  {
+    auto const lower = latency_histogram::bucket_lower_bound(i);
+    CHECK(lower == latency_histogram::bucket_upper_bound(i - 1) +
+                       std::chrono::nanoseconds(1));
+    CHECK(i == latency_histogram::bucket_index(lower));
+    CHECK(i == latency_histogram::bucket_index(
+                   latency_histogram::bucket_upper_bound(i)));
+  }
+}
+
+TEST_CASE("test thread_pool metrics count tasks and latencies")
+{
+  for (auto const sched : {thread_pool::scheduling::shared_queue,
+                           thread_pool::scheduling::work_stealing})
+  {
+    thread_pool tp;
+    thread_pool::start_config config;
+    config.thread_count = 2;
+    config.sched = sched;
+    config.record_latencies = true;
+    tp.start(config);
+
+    // keep the tasks queued until they are counted
+    promise<void> unblock;
+    auto blockers = std::vector<future<void>>();
+    for (int i = 0; i < 2; ++i)
+      blockers.push_back(async(tp, [fut = unblock.get_future().to_shared()] {
+        while (!fut.is_ready())
+          std::this_thread::yield();
+      }));
+    std::vector<fu2::unique_function<void()>> works;
+    for (int i = 0; i < 10; ++i)
+      works.push_back([] {});
+    tp.post_bulk(std::move(works));
+
+    auto const before = tp.get_metrics();
+    CHECK(12 == before.tasks_posted);
+    CHECK(before.tasks_executed + before.queue_depth <= 12);
+
+    unblock.set_value({});
+    for (auto& fut : blockers)
+      fut.get();
+    tp.stop();
+
+    auto const after = tp.get_metrics();
+    CHECK(12 == after.tasks_posted);
+    CHECK(12 == after.tasks_executed);
+    CHECK(0 == after.queue_depth);
+    CHECK(12 == after.queue_wait.count());
+    CHECK(12 == after.run_time.count());
+    if (sched == thread_pool::scheduling::shared_queue)
+      CHECK(0 == after.tasks_stolen);
+  }
+}
+
+TEST_CASE("test thread_pool can be given by reference to then")
+{
+  static_assert(is_executor_v<thread_pool>);
+  static_assert(is_executor_v<executor>);
+  static_assert(!is_executor_v<int>);
+  static_assert(std::is_trivially_copyable<executor>::value);
+
+  thread_pool tp;
+  tp.start(1);
+  auto fut = make_ready_future(21)
+                 .and_then(tp, [&](int i) {
+                   CHECK(tp.is_in_this_context());
+                   return i * 2;
+                 })
+                 .then(tp, [](future<int> fut) { return fut.get(); });
+  CHECK(42 == fut.get());
+}
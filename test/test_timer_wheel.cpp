@@ -0,0 +1,153 @@
+#include <doctest/doctest.h>
+
+#include <tconcurrent/detail/node_pool.hpp>
+#include <tconcurrent/detail/timer_wheel.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+using namespace tconcurrent;
+
+namespace
+{
+using clock = detail::timer_wheel::clock;
+
+struct test_timer final : detail::timer_node
+{
+  std::function<void()> on_fire;
+
+  explicit test_timer(std::function<void()> on_fire)
+    : on_fire(std::move(on_fire))
+  {
+  }
+
+  void fire() override
+  {
+    on_fire();
+  }
+};
+
+std::shared_ptr<test_timer> make_timer(std::function<void()> on_fire)
+{
+  return detail::make_pooled_shared<test_timer>(std::move(on_fire));
+}
+}
+
+TEST_CASE("timer wheel should fire timers in the order of their deadlines")
+{
+  boost::asio::io_context io;
+  auto& wheel = detail::timer_wheel::get(io);
+
+  // some timers go down from the higher levels before they fire
+  std::vector<int> const delays_ms{150, 3, 70, 0, 64, 20, 300, 65, 1};
+  std::vector<int> fired;
+  auto const now = clock::now();
+  for (auto const delay : delays_ms)
+    wheel.arm(make_timer([&, delay] { fired.push_back(delay); }),
+              now + std::chrono::milliseconds(delay));
+  CHECK(wheel.size() == delays_ms.size());
+
+  io.run();
+
+  auto expected = delays_ms;
+  std::sort(expected.begin(), expected.end());
+  CHECK(fired == expected);
+  CHECK(wheel.size() == 0);
+}
+
+TEST_CASE("timer wheel should never fire a timer early")
+{
+  boost::asio::io_context io;
+  auto& wheel = detail::timer_wheel::get(io);
+
+  int nb_early = 0;
+  int nb_fired = 0;
+  for (auto delay = 0; delay < 200; delay += 7)
+  {
+    auto const deadline =
+        clock::now() + std::chrono::microseconds(delay * 1000 + 500);
+    wheel.arm(make_timer([&, deadline] {
+                ++nb_fired;
+                if (clock::now() < deadline)
+                  ++nb_early;
+              }),
+              deadline);
+  }
+
+  io.run();
+
+  CHECK(nb_fired == 29);
+  CHECK(nb_early == 0);
+}
+
+TEST_CASE("timer wheel should group timers whose slack windows overlap")
+{
+  boost::asio::io_context io;
+  auto& wheel = detail::timer_wheel::get(io);
+
+  std::vector<clock::time_point> fire_times;
+  int nb_early = 0;
+  auto const now = clock::now();
+  for (auto i = 0; i < 100; ++i)
+  {
+    auto const deadline = now + std::chrono::milliseconds(50 + i / 10);
+    wheel.arm(make_timer([&, deadline] {
+                fire_times.push_back(clock::now());
+                if (fire_times.back() < deadline)
+                  ++nb_early;
+              }),
+              deadline,
+              std::chrono::milliseconds(100));
+  }
+
+  io.run();
+
+  REQUIRE(fire_times.size() == 100);
+  CHECK(nb_early == 0);
+  // every window contains one or two multiples of 64 ticks and the timers go
+  // to one of them
+  auto nb_wakeups = 1;
+  for (auto i = 1u; i < fire_times.size(); ++i)
+    if (fire_times[i] - fire_times[i - 1] > std::chrono::milliseconds(20))
+      ++nb_wakeups;
+  CHECK(nb_wakeups <= 2);
+}
+
+TEST_CASE("timer wheel should not fire canceled timers")
+{
+  boost::asio::io_context io;
+  auto& wheel = detail::timer_wheel::get(io);
+
+  std::vector<std::shared_ptr<test_timer>> timers;
+  int nb_fired = 0;
+  for (auto i = 0; i < 100; ++i)
+  {
+    timers.push_back(make_timer([&] { ++nb_fired; }));
+    wheel.arm(timers.back(), clock::now() + std::chrono::milliseconds(i));
+  }
+  for (auto i = 0; i < 100; i += 2)
+    CHECK(wheel.cancel(*timers[i]));
+  CHECK(wheel.size() == 50);
+
+  io.run();
+
+  CHECK(nb_fired == 50);
+  CHECK(!wheel.cancel(*timers[1]));
+}
+
+TEST_CASE("timer wheel should drop its timers when the io_context is destroyed")
+{
+  std::weak_ptr<test_timer> weak_timer;
+  bool fired = false;
+  {
+    boost::asio::io_context io;
+    auto const timer = make_timer([&] { fired = true; });
+    weak_timer = timer;
+    detail::timer_wheel::get(io).arm(timer,
+                                     clock::now() + std::chrono::hours(1));
+  }
+  CHECK(weak_timer.expired());
+  CHECK(!fired);
+}
@@ -1,7 +1,18 @@
 #include <doctest/doctest.h>
 
+#include <tconcurrent/async.hpp>
+#ifndef EMSCRIPTEN
+#include <tconcurrent/thread_pool.hpp>
+#endif
 #include <tconcurrent/when.hpp>
 
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
 using namespace tconcurrent;
 
 TEST_CASE("test when_all")
@@ -63,6 +74,132 @@ TEST_CASE("when_all should propagate cancel")
   }));
 }
 
+TEST_CASE("when_all_values")
+{
+  auto const NB_FUTURES = 10;
+
+  std::vector<promise<int>> promises(NB_FUTURES);
+  std::vector<future<int>> futures;
+  for (auto const& prom : promises)
+    futures.push_back(prom.get_future());
+
+  auto all = when_all_values(std::make_move_iterator(futures.begin()),
+                             std::make_move_iterator(futures.end()));
+
+  SUBCASE("should get the values in order")
+  {
+    for (int i = NB_FUTURES - 1; i >= 0; --i)
+    {
+      CHECK(!all.is_ready());
+      promises[i].set_value(i * 2);
+    }
+
+    REQUIRE(all.is_ready());
+    auto const values = all.get();
+    REQUIRE(values.size() == NB_FUTURES);
+    for (int i = 0; i < NB_FUTURES; ++i)
+      CHECK(values[i] == i * 2);
+  }
+
+  SUBCASE("should fail as soon as a future fails and cancel the others")
+  {
+    promises[0].set_value(0);
+    promises[3].set_exception(
+        std::make_exception_ptr(std::runtime_error("three")));
+
+    REQUIRE(all.is_ready());
+    CHECK_THROWS_AS(all.get(), std::runtime_error);
+    for (int i = 1; i < NB_FUTURES; ++i)
+      if (i != 3)
+        CHECK(promises[i].get_cancelation_token().is_cancel_requested());
+
+    // the late results are ignored
+    promises[4].set_value(4);
+    promises[5].set_exception(
+        std::make_exception_ptr(std::logic_error("five")));
+  }
+
+  SUBCASE("should propagate cancel")
+  {
+    all.request_cancel();
+
+    CHECK(std::all_of(promises.begin(), promises.end(), [](auto& prom) {
+      return prom.get_cancelation_token().is_cancel_requested();
+    }));
+  }
+}
+
+TEST_CASE("when_all_values should work with values that can not be default "
+          "constructed")
+{
+  struct no_default
+  {
+    explicit no_default(int i) : i(i)
+    {
+    }
+    int i;
+  };
+
+  std::vector<future<no_default>> futures;
+  futures.push_back(make_ready_future(no_default{1}));
+  futures.push_back(make_ready_future(no_default{2}));
+  auto all = when_all_values(std::make_move_iterator(futures.begin()),
+                             std::make_move_iterator(futures.end()));
+  REQUIRE(all.is_ready());
+  auto const values = all.get();
+  REQUIRE(values.size() == 2);
+  CHECK(values[0].i == 1);
+  CHECK(values[1].i == 2);
+}
+
+#ifndef EMSCRIPTEN
+TEST_CASE("when_all_values should get bools set from several threads")
+{
+  auto const NB_THREADS = 4;
+  auto const NB_FUTURES = 1000;
+
+  thread_pool tp;
+  tp.start(NB_THREADS);
+
+  std::vector<promise<bool>> promises(NB_FUTURES);
+  std::vector<future<bool>> futures;
+  for (auto const& prom : promises)
+    futures.push_back(prom.get_future());
+  auto all = when_all_values(std::make_move_iterator(futures.begin()),
+                             std::make_move_iterator(futures.end()));
+
+  // each thread sets every NB_THREADS-th value, so that neighbors are set
+  // concurrently
+  std::atomic<int> nb_started{0};
+  std::vector<future<void>> setters;
+  for (int t = 0; t < NB_THREADS; ++t)
+    setters.push_back(async(tp, [&, t] {
+      ++nb_started;
+      while (nb_started.load() != NB_THREADS)
+        std::this_thread::yield();
+      for (int i = t; i < NB_FUTURES; i += NB_THREADS)
+        promises[i].set_value(i % 3 == 0);
+    }));
+  for (auto& setter : setters)
+    setter.get();
+
+  auto const values = all.get();
+  REQUIRE(values.size() == NB_FUTURES);
+  for (int i = 0; i < NB_FUTURES; ++i)
+    CHECK(values[i] == (i % 3 == 0));
+}
+#endif
+
+TEST_CASE("when_all_values on empty vector should return a ready future")
+{
+  std::vector<future<void>> futures;
+  auto all = when_all_values(std::make_move_iterator(futures.begin()),
+                             std::make_move_iterator(futures.end()));
+  static_assert(std::is_same_v<decltype(all), future<std::vector<tvoid>>>);
+  CHECK(all.is_ready());
+  CHECK(all.get().empty());
+}
+
 TEST_CASE("when_any on empty vector should return a ready future")
 {
   std::vector<future<int>> futures;
@@ -156,3 +293,105 @@ TEST_CASE("when_any")
     }));
   }
 }
+
+TEST_CASE("variadic when_all")
+{
+  promise<int> prom1;
+  promise<void> prom2;
+  promise<std::string> prom3;
+  auto const shared = prom3.get_future().to_shared();
+
+  auto all = when_all(prom1.get_future(), prom2.get_future(), shared);
+  static_assert(std::is_same_v<decltype(all),
+                               future<std::tuple<future<int>,
+                                                 future<void>,
+                                                 shared_future<std::string>>>>);
+
+  SUBCASE("should get ready when all futures are ready")
+  {
+    prom2.set_value({});
+    prom3.set_value("three");
+    CHECK(!all.is_ready());
+    prom1.set_exception(std::make_exception_ptr(std::runtime_error("one")));
+
+    REQUIRE(all.is_ready());
+    auto [fut1, fut2, fut3] = all.get();
+    CHECK(fut1.has_exception());
+    CHECK(fut2.has_value());
+    CHECK(fut3.get() == "three");
+  }
+
+  SUBCASE("should propagate cancel")
+  {
+    all.request_cancel();
+
+    CHECK(prom1.get_cancelation_token().is_cancel_requested());
+    CHECK(prom2.get_cancelation_token().is_cancel_requested());
+    CHECK(prom3.get_cancelation_token().is_cancel_requested());
+  }
+}
+
+TEST_CASE("variadic when_all without futures should return a ready future")
+{
+  auto all = when_all();
+  CHECK(all.is_ready());
+}
+
+TEST_CASE("variadic when_any")
+{
+  promise<int> prom1;
+  promise<void> prom2;
+  promise<std::string> prom3;
+
+  SUBCASE("should get ready when one future is ready")
+  {
+    auto any =
+        when_any(prom1.get_future(), prom2.get_future(), prom3.get_future());
+    CHECK(!any.is_ready());
+
+    prom3.set_value("three");
+    prom2.set_value({});
+
+    REQUIRE(any.is_ready());
+    auto result = any.get();
+    CHECK(result.index == 2);
+    CHECK(std::get<2>(result.futures).get() == "three");
+    CHECK(!std::get<0>(result.futures).is_ready());
+    CHECK(!prom1.get_cancelation_token().is_cancel_requested());
+  }
+
+  SUBCASE("should return a ready future if one future is already ready")
+  {
+    prom2.set_value({});
+
+    auto any =
+        when_any(prom1.get_future(), prom2.get_future(), prom3.get_future());
+    REQUIRE(any.is_ready());
+    CHECK(any.get().index == 1);
+  }
+
+  SUBCASE("should cancel all other futures when a future gets ready")
+  {
+    auto any = when_any(when_any_options::auto_cancel,
+                        prom1.get_future(),
+                        prom2.get_future(),
+                        prom3.get_future());
+
+    prom1.set_value(1);
+
+    CHECK(any.is_ready());
+    CHECK(prom2.get_cancelation_token().is_cancel_requested());
+    CHECK(prom3.get_cancelation_token().is_cancel_requested());
+  }
+
+  SUBCASE("should propagate cancel")
+  {
+    auto any =
+        when_any(prom1.get_future(), prom2.get_future(), prom3.get_future());
+    any.request_cancel();
+
+    CHECK(prom1.get_cancelation_token().is_cancel_requested());
+    CHECK(prom2.get_cancelation_token().is_cancel_requested());
+    CHECK(prom3.get_cancelation_token().is_cancel_requested());
+  }
+}
@@ -0,0 +1,55 @@
+#include <doctest/doctest.h>
+
+#include <tconcurrent/async_wait.hpp>
+#include <tconcurrent/promise.hpp>
+#include <tconcurrent/with_timeout.hpp>
+
+#include <stdexcept>
+
+using namespace std::chrono_literals;
+using namespace tconcurrent;
+
+TEST_CASE("with_timeout should finish like the future if it is ready first")
+{
+  promise<int> prom;
+  auto fut = with_timeout(prom.get_future(), 1h);
+  CHECK(!fut.is_ready());
+
+  SUBCASE("with a value")
+  {
+    prom.set_value(42);
+    CHECK(fut.get() == 42);
+  }
+  SUBCASE("with an error")
+  {
+    prom.set_exception(std::make_exception_ptr(std::runtime_error("fail")));
+    CHECK_THROWS_AS(fut.get(), std::runtime_error);
+  }
+}
+
+TEST_CASE("with_timeout should work on ready futures")
+{
+  CHECK(with_timeout(make_ready_future(42), 1h).get() == 42);
+}
+
+TEST_CASE("with_timeout should cancel the future when the timeout expires")
+{
+  promise<void> prom;
+  bool canceled = false;
+  prom.get_cancelation_token().push_cancelation_callback(
+      [&] { canceled = true; });
+
+  auto fut = with_timeout(prom.get_future(), 10ms);
+  CHECK_THROWS_AS(fut.get(), timed_out);
+  CHECK(canceled);
+
+  // the result that comes too late is ignored
+  prom.set_value({});
+}
+
+TEST_CASE("with_timeout should propagate cancelation requests")
+{
+  auto fut = with_timeout(async_wait(1h), 1h);
+  fut.request_cancel();
+  CHECK_THROWS_AS(fut.get(), operation_canceled);
+}